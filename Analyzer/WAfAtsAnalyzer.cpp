@@ -0,0 +1,860 @@
+/*
+* Offline analyzer for session recordings made with 'record = 1' in the cfg
+* maps the recording, replays it through the plugin's input callbacks with a cfg on the recorded times
+* and reports per key noise, events per frame, how much the change check suppressed, axis reversals
+* and the latency the rate tiers, slew limits and prediction add
+* while the replay runs, the per key scan of the raw values is split in chunks over every cpu
+* synthetic input scripts replay the same way, and the events of every frame can be written out or diffed against
+* a golden log so changes to the event loop, the axis math or the cfg importer show up next to their callback cost
+*/
+
+#include <cstdio>
+#include <filesystem>
+#include <thread>
+#include <vector>
+
+//the plugin keeps its state in file scope globals, include it whole to replay through its callbacks
+#include "../WAfAts.cpp"
+#include "../MockSdk/MockWootingSdk.h"
+#include "../MockSdk/SyntheticInput.h"
+
+//a held key further than this from the middle of its neighbouring frames is moved by the driver, closer is sensor noise
+const float noiseBand = 0.02f;
+
+SCSAPI_VOID analyzerLog(const scs_log_type_t type, const scs_string_t message)
+{
+	if (type != SCS_LOG_TYPE_message) {
+		fprintf(stderr, "%s\n", message);
+	}
+}
+
+
+//the keys of the frames from first on, up to the next segment frame
+struct key_segment_t
+{
+	unsigned long long first = 0;
+	int count = 0;
+	unsigned short codes[recordingMaxKeys] = {};
+	//row of every key in the report, the same key keeps its row in every segment
+	int rows[recordingMaxKeys] = {};
+};
+
+void addSegment(unsigned long long first, const unsigned short* codes, int count, std::vector<key_segment_t>& segments, std::vector<unsigned short>& rowCodes)
+{
+	key_segment_t segment;
+	segment.first = first;
+	segment.count = count;
+	for (int k{ 0 }; k < count; ++k) {
+		segment.codes[k] = codes[k];
+		auto row = std::find(rowCodes.begin(), rowCodes.end(), codes[k]);
+		segment.rows[k] = int(row - rowCodes.begin());
+		if (row == rowCodes.end()) {
+			rowCodes.push_back(codes[k]);
+		}
+	}
+	segments.push_back(segment);
+}
+
+//the segment of the header and one for every segment frame
+void findSegments(const recording_header_t& header, const recording_frame_t* frames, unsigned long long frameCount, std::vector<key_segment_t>& segments, std::vector<unsigned short>& rowCodes)
+{
+	addSegment(0, header.codes, int(header.keyCount), segments, rowCodes);
+	for (unsigned long long f{ 0 }; f < frameCount; ++f) {
+		if (!(frames[f].flags & recording_frame_segment)) {
+			continue;
+		}
+		unsigned short codes[recordingMaxKeys];
+		int count = std::min(int(frames[f].speed), recordingMaxKeys);
+		for (int k{ 0 }; k < count; ++k) {
+			codes[k] = (unsigned short)frames[f].values[k];
+		}
+		addSegment(f + 1, codes, count, segments, rowCodes);
+	}
+}
+
+
+//raw values of one key over a run of frames, chunks are scanned on their own threads and merged in file order
+struct key_scan_t
+{
+	unsigned long long held = 0;
+	//how far a held key is from the middle of its neighbours, smooth movement cancels out and sensor noise stays
+	//for white noise of deviation d the residual has a deviation of d * sqrt(1.5)
+	unsigned long long noiseSamples = 0;
+	double noiseSquares = 0.0;
+	float noisePeak = 0.0f;
+	//direction changes of the held key
+	unsigned long long reversals = 0;
+	//direction of the first and last step of the run, 0 if it had none, so merging counts reversals across chunk borders
+	int firstSign = 0;
+	int lastSign = 0;
+};
+
+//a row per key of every segment
+struct chunk_scan_t
+{
+	std::vector<key_scan_t> keys;
+};
+
+//frames first to last of frameCount, the frames around a chunk are read too so no step or residual at its borders is lost
+void scanChunk(const recording_frame_t* frames, unsigned long long frameCount, unsigned long long first, unsigned long long last, const std::vector<key_segment_t>& segments, chunk_scan_t& scan)
+{
+	size_t s = 0;
+	for (unsigned long long f{ first }; f < last; ++f) {
+		const recording_frame_t& frame = frames[f];
+		while (s + 1 < segments.size() && segments[s + 1].first <= f) {
+			++s;
+		}
+		//a segment frame holds key codes, and the frames on either side of it are of different keys
+		if (frame.flags & recording_frame_segment) {
+			continue;
+		}
+		const key_segment_t& segment = segments[s];
+		bool step = f > 0 && !(frame.flags & recording_frame_resync) && !(frames[f - 1].flags & recording_frame_segment);
+		bool between = step && f + 1 < frameCount && !(frames[f + 1].flags & (recording_frame_resync | recording_frame_segment));
+		for (int k{ 0 }; k < segment.count; ++k) {
+			key_scan_t& key = scan.keys[segment.rows[k]];
+			float value = frame.values[k];
+			if (value <= 0.0f) {
+				continue;
+			}
+			++key.held;
+			if (!step) {
+				continue;
+			}
+			float previous = frames[f - 1].values[k];
+			if (between && previous > 0.0f && frames[f + 1].values[k] > 0.0f) {
+				float residual = value - 0.5f * (previous + frames[f + 1].values[k]);
+				if (std::fabs(residual) < noiseBand) {
+					++key.noiseSamples;
+					key.noiseSquares += double(residual) * double(residual) / 1.5;
+					key.noisePeak = std::fmax(key.noisePeak, std::fabs(residual));
+				}
+			}
+			float delta = value - previous;
+			int sign = delta > 0.0f ? 1 : (delta < 0.0f ? -1 : 0);
+			if (sign == 0) {
+				continue;
+			}
+			if (key.lastSign == -sign) {
+				++key.reversals;
+			}
+			if (key.firstSign == 0) {
+				key.firstSign = sign;
+			}
+			key.lastSign = sign;
+		}
+	}
+}
+
+void mergeScan(key_scan_t& total, const key_scan_t& chunk)
+{
+	if (total.lastSign != 0 && total.lastSign == -chunk.firstSign) {
+		++total.reversals;
+	}
+	if (total.firstSign == 0) {
+		total.firstSign = chunk.firstSign;
+	}
+	if (chunk.lastSign != 0) {
+		total.lastSign = chunk.lastSign;
+	}
+	total.held += chunk.held;
+	total.noiseSamples += chunk.noiseSamples;
+	total.noiseSquares += chunk.noiseSquares;
+	total.noisePeak = std::fmax(total.noisePeak, chunk.noisePeak);
+	total.reversals += chunk.reversals;
+}
+
+
+//what the game got for one axis over the replay
+struct axis_replay_t
+{
+	unsigned long long events = 0;
+	unsigned long long reversals = 0;
+	int lastSign = 0;
+	//the value the game holds
+	float reported = 0.0f;
+	//added latency is how far the reported value trails the recorded key position while it moves, divided by how fast it moves
+	//sum of (position - reported) * direction * frame time over sum of |position change|, in seconds for a steady move
+	double lagSum = 0.0;
+	double travelSum = 0.0;
+	float lastPosition = NAN;
+	//frames it couldn't be measured in, derived and speed shaped axes report something else than their key position
+	unsigned long long unmeasured = 0;
+};
+
+//every axis is reported at most once per frame, on the one device it is on
+const int maxEventsPerFrame = numOfAxes;
+
+struct frame_event_t
+{
+	int device;
+	int input;
+	float value;
+};
+
+//where the events of every frame go besides the report, one line per frame: <frame> <device>.<input>=<value> ...
+struct event_log_t
+{
+	//write them, NULL = don't
+	FILE* out = NULL;
+	//compare them with a log written before, values may differ by tolerance to allow for other compilers' libm
+	std::ifstream* golden = NULL;
+	float tolerance = 0.0f;
+	unsigned long long differentFrames = 0;
+};
+
+struct replay_t
+{
+	axis_replay_t axes[numOfAxes];
+	//frames by number of events in them
+	unsigned long long eventsPerFrame[maxEventsPerFrame + 1] = {};
+	unsigned long long activeAxes = 0;
+	unsigned long long suppressed = 0;
+	unsigned long long frameTimeSum = 0;
+	unsigned long long frameTimes = 0;
+	//frames a --session replayed with the game paused
+	unsigned long long pausedFrames = 0;
+	//ns spent in input_event_callback per frame, all devices together
+	std::vector<unsigned int> costs;
+};
+
+long long replayTime = 0;
+
+long long replayClock()
+{
+	return replayTime;
+}
+
+//position of the axis from this frame's recorded values, what it would report if nothing but the keys shaped it
+float recordedPosition(const inputData& input)
+{
+	if (input.type == single) {
+		return mockKeyValues[input.hidCode1];
+	}
+	else if (input.type == dual) {
+		return calculateSharedAxis(mockKeyValues[input.hidCode1], mockKeyValues[input.hidCode2]);
+	}
+	return 0.0f;
+}
+
+//axis behind an input of a registered device
+int axisOfInput(int device, int input)
+{
+	const registered_device_t& registered = registeredDevices[device];
+	for (int i{ 0 }; i < numOfAxes; ++i) {
+		if ((registered.axes & (1u << i)) && registered.inputIndex[i] == input) {
+			return i;
+		}
+	}
+	return 0;
+}
+
+void printEvents(FILE* out, const frame_event_t* events, int count)
+{
+	for (int e{ 0 }; e < count; ++e) {
+		fprintf(out, " %i.%i=%.9g", events[e].device, events[e].input, events[e].value);
+	}
+}
+
+//check a frame against the next line of the golden log, the first few differences are printed
+void compareGolden(event_log_t& log, unsigned long long frame, const frame_event_t* events, int count)
+{
+	std::string line;
+	while (std::getline(*log.golden, line) && line.compare(0, 1, "#") == 0) {
+	}
+	std::istringstream tokens(line);
+	unsigned long long goldenFrame = 0;
+	bool same = static_cast<bool>(tokens >> goldenFrame) && goldenFrame == frame;
+	std::string token;
+	int e = 0;
+	while (same && tokens >> token) {
+		frame_event_t golden;
+		same = sscanf_s(token.c_str(), "%i.%i=%f", &golden.device, &golden.input, &golden.value) == 3 && e < count
+			&& golden.device == events[e].device && golden.input == events[e].input && std::fabs(golden.value - events[e].value) <= log.tolerance;
+		++e;
+	}
+	same = same && e == count;
+	if (same) {
+		return;
+	}
+	if (++log.differentFrames <= 10) {
+		printf("frame %llu differs\n  golden: %s\n  got:    %llu", frame, line.empty() ? "(end of file)" : line.c_str(), frame);
+		printEvents(stdout, events, count);
+		printf("\n");
+	}
+}
+
+//a --session pauses the game for the last sessionPauseFrames of every sessionPauseEvery frames, a second every minute at 60 fps
+const unsigned long long sessionPauseEvery = 3600;
+const unsigned long long sessionPauseFrames = 60;
+
+//what scs_input_init does besides reading keys, for --session: stats summaries and their export, key calibration and recording the replay
+//the plugin writes those files to plugins/ of the working directory, so the session moves to dir first
+bool startSession(const char* dir)
+{
+	std::error_code error;
+	std::filesystem::create_directories(std::filesystem::path(dir) / "plugins", error);
+	if (!error) {
+		std::filesystem::current_path(dir, error);
+	}
+	if (error) {
+		fprintf(stderr, "can't write the session files to %s/plugins\n", dir);
+		return false;
+	}
+	settings.statsSummaryS = settings.statsSummaryS > 0 ? settings.statsSummaryS : 60;
+	settings.statsExport = true;
+	settings.calibrate = true;
+	settings.record = true;
+	settings.pauseSampling = true;
+	size_t arenaBytes = statsArenaBytes(true) + recordingArenaBytes + alignof(recording_frame_t);
+	if (!heapArenaInit(arenaBytes)) {
+		fprintf(stderr, "can't allocate %zu bytes for the session buffers\n", arenaBytes);
+		return false;
+	}
+	statsInit(settings.statsSummaryS, true);
+	calibrationEnabled = true;
+	calibrationLoad();
+	if (!recordingStart("plugins/WAfAts.rec", boundKeys.codes, boundKeys.count, true)) {
+		fprintf(stderr, "can't record to %s/plugins/WAfAts.rec\n", dir);
+		return false;
+	}
+	telemetryActive.store(true, std::memory_order_relaxed);
+	return true;
+}
+
+//what scs_input_shutdown writes
+void stopSession()
+{
+	recordingStop();
+	calibrationSave();
+	statsShutdown();
+	heapArenaRelease();
+}
+
+//every frame through input_event_callback of every registered device, like the game calls it
+//in a session the game also pauses now and then, the paused frames only save and flush and aren't measured
+void replay(const std::vector<key_segment_t>& segments, const recording_frame_t* frames, unsigned long long frameCount, bool session, replay_t& result, event_log_t& log)
+{
+	sampleClock = replayClock;
+	result.costs.reserve(frameCount);
+	size_t s = 0;
+	for (unsigned long long f{ 0 }; f < frameCount; ++f) {
+		const recording_frame_t& frame = frames[f];
+		//the keys of the last segment are released, the game never saw a frame for it
+		if (frame.flags & recording_frame_segment) {
+			for (int k{ 0 }; k < segments[s].count; ++k) {
+				mockKeyValues[segments[s].codes[k]] = 0.0f;
+			}
+			++s;
+			continue;
+		}
+		const key_segment_t& segment = segments[s];
+		bool resync = (frame.flags & recording_frame_resync) != 0;
+		if (resync) {
+			AnalogKeyboard.resync = true;
+		}
+		long long frameTime = f > 0 && !resync ? frame.time - frames[f - 1].time : 0;
+		if (frameTime > 0) {
+			result.frameTimeSum += (unsigned long long)frameTime;
+			++result.frameTimes;
+		}
+		replayTime = frame.time;
+		telemetrySpeed.store(frame.speed, std::memory_order_relaxed);
+		if (session) {
+			bool paused = f % sessionPauseEvery >= sessionPauseEvery - sessionPauseFrames;
+			telemetryPaused.store(paused, std::memory_order_relaxed);
+			if (paused) {
+				for (int d{ 0 }; d < registeredDeviceCount; ++d) {
+					scs_input_event_t event;
+					input_event_callback(&event, SCS_INPUT_EVENT_CALLBACK_FLAG_first_in_frame, &registeredDevices[d]);
+				}
+				++result.pausedFrames;
+				continue;
+			}
+		}
+		for (int k{ 0 }; k < segment.count; ++k) {
+			mockKeyValues[segment.codes[k]] = frame.values[k];
+		}
+
+		//only the callbacks are timed, what the analyzer does with the events comes after
+		frame_event_t events[maxEventsPerFrame];
+		int count = 0;
+		long long begin = statsNow();
+		for (int d{ 0 }; d < registeredDeviceCount; ++d) {
+			registered_device_t& registered = registeredDevices[d];
+			scs_input_event_t event;
+			while (input_event_callback(&event, SCS_INPUT_EVENT_CALLBACK_FLAG_first_in_frame, &registered) == SCS_RESULT_ok && count < maxEventsPerFrame) {
+				events[count++] = { d, int(event.input_index), event.value_float.value };
+			}
+		}
+		long long cost = statsNow() - begin;
+		result.costs.push_back((unsigned int)std::min<long long>(cost, 0xffffffffll));
+
+		for (int e{ 0 }; e < count; ++e) {
+			axis_replay_t& axis = result.axes[axisOfInput(events[e].device, events[e].input)];
+			float delta = events[e].value - axis.reported;
+			int sign = delta > 0.0f ? 1 : (delta < 0.0f ? -1 : 0);
+			if (sign != 0 && axis.lastSign == -sign) {
+				++axis.reversals;
+			}
+			if (sign != 0) {
+				axis.lastSign = sign;
+			}
+			axis.reported = events[e].value;
+			++axis.events;
+		}
+		if (log.out != NULL) {
+			fprintf(log.out, "%llu", f);
+			printEvents(log.out, events, count);
+			fprintf(log.out, "\n");
+		}
+		if (log.golden != NULL) {
+			compareGolden(log, f, events, count);
+		}
+		++result.eventsPerFrame[count];
+		int active = countBits(layers[activeLayer].activeMask);
+		result.activeAxes += active;
+		result.suppressed += active > count ? active - count : 0;
+
+		for (int i{ 0 }; i < numOfAxes; ++i) {
+			const inputData& input = layers[activeLayer].inputs[i];
+			axis_replay_t& axis = result.axes[i];
+			if (input.type == disabled) {
+				axis.lastPosition = NAN;
+				continue;
+			}
+			if (input.derive != derive_none || input.speedResponse.bands != 0 || input.deadzone > 0.0f) {
+				++axis.unmeasured;
+				axis.lastPosition = NAN;
+				continue;
+			}
+			float position = recordedPosition(input);
+			float moved = position - axis.lastPosition;
+			if (frameTime > 0 && moved != 0.0f && !std::isnan(moved)) {
+				axis.lagSum += double(position - axis.reported) * (moved > 0.0f ? 1.0 : -1.0) * double(frameTime) * 1e-9;
+				axis.travelSum += std::fabs(moved);
+			}
+			axis.lastPosition = position;
+		}
+	}
+	sampleClock = statsNow;
+}
+
+//frames of a synthetic input script, as the plugin would have recorded them with the cfg's keys
+void synthesize(unsigned long long frameCount, double fps, recording_header_t& header, std::vector<recording_frame_t>& frames)
+{
+	header = recording_header_t();
+	header.magic = recordingMagic;
+	header.version = recordingVersion;
+	header.frameSize = sizeof(recording_frame_t);
+	header.keyCount = (unsigned int)boundKeys.count;
+	std::copy(boundKeys.codes, boundKeys.codes + boundKeys.count, header.codes);
+	frames.assign(frameCount, recording_frame_t());
+	long long frameNs = (long long)(1e9 / fps);
+	for (unsigned long long f{ 0 }; f < frameCount; ++f) {
+		synthAdvance(1.0 / fps);
+		recording_frame_t& frame = frames[f];
+		frame.time = 1000000000ll + (long long)f * frameNs;
+		frame.flags = f == 0 ? recording_frame_resync : 0;
+		for (int k{ 0 }; k < boundKeys.count; ++k) {
+			frame.values[k] = mockKeyValues[boundKeys.codes[k]];
+		}
+	}
+}
+
+
+//checks of the plugin's building blocks against known answers, run with --check, each returns how many of its cases failed
+struct calibration_step_t
+{
+	const char* what;
+	float raw;
+	//held for this many samples, the output is checked on the last
+	int samples;
+	float expected;
+};
+
+//a key is learned like the game thread does it, the output of every step has to come out as given
+int checkCalibration(const char* name, unsigned short code, const calibration_step_t* steps, int count)
+{
+	int failed = 0;
+	for (int s{ 0 }; s < count; ++s) {
+		float output = 0.0f;
+		for (int n{ 0 }; n < steps[s].samples; ++n) {
+			output = calibrationApply(code, steps[s].raw);
+		}
+		if (std::fabs(output - steps[s].expected) > 1e-5f) {
+			printf("FAILED: calibration %s, %s at %.3f gives %.5f instead of %.5f\n", name, steps[s].what, steps[s].raw, output, steps[s].expected);
+			++failed;
+		}
+	}
+	return failed;
+}
+
+int checkCalibrations()
+{
+	calibrationReset();
+	//rests at 0.02 and tops out at exactly 1, a partial press and a light touch after that must not narrow the range
+	const calibration_step_t creeping[] = {
+		{ "rest", 0.02f, 8, 0.0f },
+		{ "full press", 1.0f, 8, 1.0f },
+		{ "partial press", 0.9f, 8, 0.88f / 0.98f },
+		{ "release", 0.02f, 8, 0.0f },
+		{ "light touch", 0.08f, 8, 0.06f / 0.98f },
+		{ "full press again", 1.0f, 8, 1.0f },
+	};
+	//rests at exactly 0 and tops out at 0.95
+	const calibration_step_t worn[] = {
+		{ "rest", 0.0f, 8, 0.0f },
+		{ "full press", 0.95f, 8, 1.0f },
+		{ "partial press", 0.86f, 8, 0.86f / 0.95f },
+		{ "light touch", 0.05f, 8, 0.05f / 0.95f },
+		{ "release", 0.0f, 8, 0.0f },
+	};
+	//a press that stops short comes first and is taken as the top, the full press after it widens the range
+	const calibration_step_t shortFirst[] = {
+		{ "rest", 0.01f, 8, 0.0f },
+		{ "short press", 0.88f, 8, 1.0f },
+		{ "full press", 0.97f, 8, 1.0f },
+		{ "short press again", 0.88f, 8, 0.87f / 0.96f },
+		{ "glitch", 0.5f, 1, 0.49f / 0.96f },
+		{ "release", 0.01f, 8, 0.0f },
+	};
+	int failed = checkCalibration("creeping key", 4, creeping, int(sizeof(creeping) / sizeof(creeping[0])));
+	failed += checkCalibration("worn key", 7, worn, int(sizeof(worn) / sizeof(worn[0])));
+	failed += checkCalibration("short first press", 22, shortFirst, int(sizeof(shortFirst) / sizeof(shortFirst[0])));
+	calibrationReset();
+	printf("calibration: %s\n", failed == 0 ? "ok" : "FAILED");
+	return failed;
+}
+
+//every simd kernel this cpu runs against the scalar one, bit for bit on random keys, lanes and tables
+int checkFrameKernels()
+{
+	const int frames = 100000;
+	int failed = 0;
+	for (int level{ kernel_scalar + 1 }; level <= kernel_avx2; ++level) {
+		frame_kernel_fn kernel = frameKernelOf(frameKernelLevel(level));
+		if (kernel == NULL) {
+			printf("frame kernel %s: not supported here, not checked\n", frameKernelName(frameKernelLevel(level)));
+			continue;
+		}
+		int mismatches = checkFrameKernel(kernel, 0x57414641, frames);
+		if (mismatches > 0) {
+			printf("FAILED: frame kernel %s differs from the scalar one in %i of %i frames\n", frameKernelName(frameKernelLevel(level)), mismatches, frames);
+			++failed;
+		}
+		else {
+			printf("frame kernel %s: ok\n", frameKernelName(frameKernelLevel(level)));
+		}
+	}
+	return failed;
+}
+
+int runChecks()
+{
+	int failed = checkCalibrations();
+	failed += checkFrameKernels();
+	return failed == 0 ? 0 : 1;
+}
+
+
+int usage()
+{
+	fprintf(stderr, "usage: WAfAtsAnalyzer --check\n");
+	fprintf(stderr, "       WAfAtsAnalyzer <recording> | --synth <script> [--frames 600] [--fps 60]\n");
+	fprintf(stderr, "    [--cfg plugins/WAfAts.cfg] [--game ats] [--threads N]\n");
+	fprintf(stderr, "    [--events <out>] [--golden <events>] [--tolerance 1e-5] [--budget-ns N] [--session <dir>]\n");
+	return 2;
+}
+
+int main(int argc, char** argv)
+{
+	game_log = analyzerLog;
+	if (argc == 2 && strcmp(argv[1], "--check") == 0) {
+		return runChecks();
+	}
+	const char* path = NULL;
+	const char* script = NULL;
+	unsigned long long synthFrames = 600;
+	double fps = 60.0;
+	const char* cfgPath = "plugins/WAfAts.cfg";
+	std::string gameId = SCS_GAME_ID_ATS;
+	int threads = int(std::thread::hardware_concurrency());
+	const char* eventsPath = NULL;
+	const char* goldenPath = NULL;
+	float tolerance = 1e-5f;
+	long long budgetNs = 0;
+	const char* sessionDir = NULL;
+	for (int a{ 1 }; a < argc; ++a) {
+		if (strncmp(argv[a], "--", 2) != 0) {
+			if (path != NULL) {
+				return usage();
+			}
+			path = argv[a];
+			continue;
+		}
+		if (a + 1 >= argc) {
+			return usage();
+		}
+		const char* value = argv[++a];
+		if (strcmp(argv[a - 1], "--synth") == 0) {
+			script = value;
+		}
+		else if (strcmp(argv[a - 1], "--frames") == 0) {
+			synthFrames = strtoull(value, NULL, 10);
+		}
+		else if (strcmp(argv[a - 1], "--fps") == 0) {
+			fps = atof(value);
+		}
+		else if (strcmp(argv[a - 1], "--cfg") == 0) {
+			cfgPath = value;
+		}
+		else if (strcmp(argv[a - 1], "--game") == 0) {
+			gameId = value;
+		}
+		else if (strcmp(argv[a - 1], "--threads") == 0) {
+			threads = atoi(value);
+		}
+		else if (strcmp(argv[a - 1], "--events") == 0) {
+			eventsPath = value;
+		}
+		else if (strcmp(argv[a - 1], "--golden") == 0) {
+			goldenPath = value;
+		}
+		else if (strcmp(argv[a - 1], "--tolerance") == 0) {
+			tolerance = float(atof(value));
+		}
+		else if (strcmp(argv[a - 1], "--budget-ns") == 0) {
+			budgetNs = atoll(value);
+		}
+		else if (strcmp(argv[a - 1], "--session") == 0) {
+			sessionDir = value;
+		}
+		else {
+			return usage();
+		}
+	}
+	if ((path == NULL) == (script == NULL) || synthFrames == 0 || fps <= 0.0) {
+		return usage();
+	}
+	threads = threads > 0 ? threads : 1;
+
+	//the plugin as scs_input_init sets it up, with the given cfg instead of the cache and a mock sdk under it
+	std::ifstream cfg(cfgPath);
+	if (!cfg.good()) {
+		fprintf(stderr, "can't read %s\n", cfgPath);
+		return 1;
+	}
+	importInputs(cfg, gameId);
+	if (!buildBoundKeys()) {
+		return 1;
+	}
+	buildSchedule();
+	buildDerivedAxes();
+	buildPredictedAxes();
+	buildFrameKernel();
+	//the mock sdk, frames only read keys once a session is open
+	initialiseSdk();
+	selectFrameKernel();
+	buildRegisteredDevices();
+	statsInit(0, false);
+
+	mapped_file_t mapped;
+	recording_header_t header;
+	std::vector<recording_frame_t> synthesized;
+	const recording_frame_t* frames = NULL;
+	unsigned long long frameCount = 0;
+	if (script != NULL) {
+		synthReset(1);
+		if (!synthLoadScript(script)) {
+			return 1;
+		}
+		synthesize(synthFrames, fps, header, synthesized);
+		frames = synthesized.data();
+		frameCount = synthFrames;
+		path = script;
+	}
+	else {
+		if (!mapFile(path, mapped) || mapped.size < sizeof(recording_header_t)) {
+			fprintf(stderr, "can't map %s\n", path);
+			unmapFile(mapped);
+			return 1;
+		}
+		memcpy(&header, mapped.data, sizeof(header));
+		if (header.magic != recordingMagic || header.version < 1 || header.version > recordingVersion || header.frameSize != sizeof(recording_frame_t) || header.keyCount > unsigned(recordingMaxKeys)) {
+			fprintf(stderr, "%s is no recording of this version\n", path);
+			unmapFile(mapped);
+			return 1;
+		}
+		frames = reinterpret_cast<const recording_frame_t*>(mapped.data + sizeof(header));
+		frameCount = (mapped.size - sizeof(header)) / sizeof(recording_frame_t);
+		if (frameCount == 0) {
+			fprintf(stderr, "%s has no frames\n", path);
+			unmapFile(mapped);
+			return 1;
+		}
+	}
+	std::vector<key_segment_t> segments;
+	std::vector<unsigned short> rowCodes;
+	findSegments(header, frames, frameCount, segments, rowCodes);
+	for (int i{ 0 }; i < boundKeys.count; ++i) {
+		if (std::find(rowCodes.begin(), rowCodes.end(), boundKeys.codes[i]) == rowCodes.end()) {
+			fprintf(stderr, "key %u of the cfg isn't in the recording, it stays released\n", boundKeys.codes[i]);
+		}
+	}
+
+	event_log_t log;
+	std::ifstream golden;
+	if (eventsPath != NULL) {
+		if (fopen_s(&log.out, eventsPath, "w") != 0 || log.out == NULL) {
+			fprintf(stderr, "can't write %s\n", eventsPath);
+			unmapFile(mapped);
+			return 1;
+		}
+		fprintf(log.out, "# events of %s with %s, <frame> <device>.<input>=<value>\n", path, cfgPath);
+	}
+	if (goldenPath != NULL) {
+		golden.open(goldenPath);
+		if (!golden.good()) {
+			fprintf(stderr, "can't read %s\n", goldenPath);
+			unmapFile(mapped);
+			return 1;
+		}
+		log.golden = &golden;
+		log.tolerance = tolerance;
+	}
+
+	long long begin = statsNow();
+	unsigned long long chunkCount = std::min<unsigned long long>(threads, frameCount);
+	std::vector<chunk_scan_t> chunks(chunkCount);
+	for (chunk_scan_t& chunk : chunks) {
+		chunk.keys.resize(rowCodes.size());
+	}
+	std::vector<std::thread> workers;
+	for (unsigned long long c{ 0 }; c < chunkCount; ++c) {
+		unsigned long long first = frameCount * c / chunkCount;
+		unsigned long long last = frameCount * (c + 1) / chunkCount;
+		workers.emplace_back(scanChunk, frames, frameCount, first, last, std::cref(segments), std::ref(chunks[c]));
+	}
+	static replay_t result;
+	//last, the recording and the event logs are opened relative to where the analyzer was started
+	if (sessionDir != NULL && !startSession(sessionDir)) {
+		unmapFile(mapped);
+		return 1;
+	}
+#ifdef WAFATS_ALLOC_CHECK
+	//only allocations inside the callbacks count, the analyzer's own don't
+	heapCheckArm();
+#endif
+	replay(segments, frames, frameCount, sessionDir != NULL, result, log);
+#ifdef WAFATS_ALLOC_CHECK
+	heapCheckDisarm();
+#endif
+	if (sessionDir != NULL) {
+		stopSession();
+	}
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+	std::vector<key_scan_t> keys(rowCodes.size());
+	for (unsigned long long c{ 0 }; c < chunkCount; ++c) {
+		for (size_t k{ 0 }; k < rowCodes.size(); ++k) {
+			mergeScan(keys[k], chunks[c].keys[k]);
+		}
+	}
+	double seconds = double(statsNow() - begin) * 1e-9;
+	if (log.out != NULL) {
+		fclose(log.out);
+	}
+
+	double recorded = double(frames[frameCount - 1].time - frames[0].time) * 1e-9;
+	printf("%s: %llu frames over %.1f min, %zu keys%s\n", path, frameCount, recorded / 60.0, rowCodes.size(), header.calibrated ? ", calibrated" : "");
+	if (segments.size() > 1) {
+		printf("the keys changed %zu times, with the keyboard layout\n", segments.size() - 1);
+	}
+	if (mapped.data != NULL && mapped.size - sizeof(header) != frameCount * sizeof(recording_frame_t)) {
+		printf("the last frame is cut short, the recording didn't end cleanly\n");
+	}
+	printf("analyzed %.0f MB in %.2f s on %llu threads\n", double(frameCount * sizeof(recording_frame_t)) / 1e6, seconds, chunkCount);
+	if (sessionDir != NULL) {
+		printf("session with stats summaries every %i s, calibration and recording, %llu frames paused, files in %s/plugins\n", settings.statsSummaryS, result.pausedFrames, sessionDir);
+	}
+	if (result.frameTimes > 0) {
+		printf("frame time %.2f ms\n", double(result.frameTimeSum) / double(result.frameTimes) * 1e-6);
+	}
+
+	printf("\nkey   held %%   noise rms   noise peak   reversals\n");
+	for (size_t k{ 0 }; k < rowCodes.size(); ++k) {
+		const key_scan_t& key = keys[k];
+		double rms = key.noiseSamples > 0 ? std::sqrt(key.noiseSquares / double(key.noiseSamples)) : 0.0;
+		printf("%3u  %6.2f   %9.5f   %10.5f   %9llu\n", rowCodes[k], 100.0 * double(key.held) / double(frameCount), rms, key.noisePeak, key.reversals);
+	}
+
+	printf("\naxis  events        reversals   added latency\n");
+	for (int i{ 0 }; i < numOfAxes; ++i) {
+		const axis_replay_t& axis = result.axes[i];
+		if (axis.events == 0 && axis.travelSum == 0.0) {
+			continue;
+		}
+		printf("%4i  %12llu  %11llu   ", i, axis.events, axis.reversals);
+		if (axis.travelSum > 0.0) {
+			printf("%.1f ms", axis.lagSum / axis.travelSum * 1000.0);
+		}
+		else {
+			printf("-");
+		}
+		if (axis.unmeasured > 0) {
+			printf(" (%llu frames derived, speed shaped or in a deadzone, not measured)", axis.unmeasured);
+		}
+		printf("\n");
+	}
+
+	unsigned long long events = 0;
+	for (int e{ 0 }; e <= maxEventsPerFrame; ++e) {
+		events += result.eventsPerFrame[e] * e;
+	}
+	printf("\nevents per frame %.3f:", double(events) / double(frameCount));
+	for (int e{ 0 }; e <= maxEventsPerFrame; ++e) {
+		printf(" %i=%.1f%%", e, 100.0 * double(result.eventsPerFrame[e]) / double(frameCount));
+	}
+	printf("\nchange check suppressed %.1f%% of %llu axis updates\n", result.activeAxes > 0 ? 100.0 * double(result.suppressed) / double(result.activeAxes) : 0.0, result.activeAxes);
+
+	//callback cost of a frame, on this machine and under the mock sdk, so only comparable between runs on the same machine
+	std::vector<unsigned int>& costs = result.costs;
+	std::sort(costs.begin(), costs.end());
+	long long p99 = costs[(costs.size() - 1) * 99 / 100];
+	printf("callbacks per frame ns p50 = %u, p99 = %lld, max = %u\n", costs[(costs.size() - 1) / 2], p99, costs.back());
+
+	int failed = 0;
+	if (log.golden != NULL) {
+		std::string line;
+		while (std::getline(golden, line)) {
+			if (!line.empty() && line.compare(0, 1, "#") != 0) {
+				++log.differentFrames;
+			}
+		}
+		if (log.differentFrames > 0) {
+			printf("FAILED: %llu frames differ from %s\n", log.differentFrames, goldenPath);
+			failed = 1;
+		}
+		else {
+			printf("events match %s\n", goldenPath);
+		}
+	}
+	if (budgetNs > 0 && p99 > budgetNs) {
+		printf("FAILED: p99 callback cost %lld ns is over the budget of %lld ns\n", p99, budgetNs);
+		failed = 1;
+	}
+#ifdef WAFATS_ALLOC_CHECK
+	if (heapCheckCount() > 0) {
+		printf("FAILED: %llu heap allocations in the callbacks over %llu frames\n", heapCheckCount(), frameCount);
+		failed = 1;
+	}
+	else {
+		printf("no heap allocations in the callbacks over %llu frames\n", frameCount);
+	}
+#endif
+
+	unmapFile(mapped);
+	return failed;
+}
@@ -0,0 +1,396 @@
+/*
+* Google Benchmark microbenchmarks for the plugin's hot functions
+* runs the plugin against MockSdk, writes cfg files to plugins/ in the working directory
+* save results with --benchmark_out=results.json --benchmark_out_format=json
+* and check them with compare_benchmarks.py baseline.json results.json
+*/
+
+#include <benchmark/benchmark.h>
+
+#include <filesystem>
+
+//the plugin keeps its state in file scope globals, include it whole to reach them
+#include "../WAfAts.cpp"
+#include "../MockSdk/MockWootingSdk.h"
+#include "../MockSdk/SyntheticInput.h"
+
+
+SCSAPI_VOID benchLog(const scs_log_type_t UNUSED(type), const scs_string_t UNUSED(message))
+{
+}
+
+//extra is written after the setting lines, for sections
+void writeCfg(int settingLines, int commentLines, const char* extra = "")
+{
+	std::filesystem::create_directories("plugins");
+	std::ofstream cfg("plugins/WAfAts.cfg", std::ios::trunc);
+	cfg << "Analog key W, 26\nAnalog key S, 22\nAnalog keys A D, 4, 7\nAnalog keys U D, 81, 82\nAnalog keys L R, 80, 79\n\n";
+	for (int i{ 0 }; i < settingLines; ++i) {
+		cfg << "trace_trigger_us = " << i << "\n";
+	}
+	cfg << extra;
+	cfg << "//comments\n";
+	for (int i{ 0 }; i < commentLines; ++i) {
+		cfg << "comment line " << i << "\n";
+	}
+}
+
+//plugin state as after scs_input_init with the default cfg
+void setupPlugin()
+{
+	game_log = benchLog;
+	writeCfg(0, 0);
+	loadInputs("ats");
+	buildBoundKeys();
+	buildSchedule();
+	buildDerivedAxes();
+	buildPredictedAxes();
+	buildFrameKernel();
+	//the mock sdk, frames only read keys once a session is open
+	initialiseSdk();
+	selectFrameKernel();
+	AnalogKeyboard = device_data_t();
+	AnalogKeyboard.dueAxes = ~0u;
+	buildRegisteredDevices();
+	std::fill(std::begin(mockKeyValues), std::end(mockKeyValues), 0.0f);
+	mockLatencyNs = 0;
+}
+
+//press or release every bound key
+void setAllKeys(float value)
+{
+	for (int i{ 0 }; i < boundKeys.count; ++i) {
+		mockKeyValues[boundKeys.codes[i]] = value;
+	}
+}
+
+
+//arg 0 = no axis changed, 1 = every axis changed
+void BM_getNextKeyChanged(benchmark::State& state)
+{
+	setupPlugin();
+	bool allChanged = state.range(0) != 0;
+	long long events = 0;
+	float value = 0.5f;
+	for (auto _ : state) {
+		if (allChanged) {
+			value = value == 0.5f ? 0.25f : 0.5f;
+			//the A key of the steering axis must stay different from D
+			std::fill(boundKeys.values, boundKeys.values + boundKeys.count, value);
+			boundKeys.values[layers[0].inputs[2].keyIndex1] = 0.0f;
+			boundKeys.values[layers[0].inputs[3].keyIndex1] = 0.0f;
+			boundKeys.values[layers[0].inputs[4].keyIndex1] = 0.0f;
+		}
+		evaluateAxes(AnalogKeyboard);
+		while (getNextKeyChanged(AnalogKeyboard, registeredDevices[0]) >= 0) {
+			++events;
+		}
+	}
+	state.counters["events/s"] = benchmark::Counter(double(events), benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_getNextKeyChanged)->Arg(0)->Arg(1);
+
+
+void BM_calculateSharedAxis(benchmark::State& state)
+{
+	float left[64];
+	float right[64];
+	for (int i{ 0 }; i < 64; ++i) {
+		left[i] = float(i % 7) / 7.0f;
+		right[i] = float(i % 5) / 5.0f;
+	}
+	for (auto _ : state) {
+		for (int i{ 0 }; i < 64; ++i) {
+			benchmark::DoNotOptimize(calculateSharedAxis(left[i], right[i]));
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * 64);
+}
+BENCHMARK(BM_calculateSharedAxis);
+
+
+//every axis changes every frame, arg = frameKernelLevel, skipped if the cpu doesn't have it
+void BM_frameKernel(benchmark::State& state)
+{
+	setupPlugin();
+	frame_kernel_fn kernel = frameKernelOf(frameKernelLevel(state.range(0)));
+	if (kernel == NULL) {
+		state.SkipWithError("not supported by this cpu");
+		return;
+	}
+	frame_kernel_t& axisKernel = layers[0].kernel;
+	float value = 0.5f;
+	unsigned int changed = 0;
+	for (auto _ : state) {
+		value = value == 0.5f ? 0.25f : 0.5f;
+		std::fill(boundKeys.values, boundKeys.values + boundKeys.count, value);
+		changed |= kernel(axisKernel, boundKeys.values);
+		std::copy(axisKernel.outputs, axisKernel.outputs + kernelLanes, axisKernel.lastReported);
+	}
+	benchmark::DoNotOptimize(changed);
+	state.SetItemsProcessed(state.iterations() * numOfAxes);
+}
+BENCHMARK(BM_frameKernel)->Arg(kernel_scalar)->Arg(kernel_sse2)->Arg(kernel_avx2);
+
+
+//reads of every bound key in one frame
+//arg = latency injected into every mock sdk read in ns
+void BM_readKeys(benchmark::State& state)
+{
+	setupPlugin();
+	mockLatencyNs = state.range(0);
+	setAllKeys(0.5f);
+	key_reads_t reads;
+	reads.keyMask = (1u << boundKeys.count) - 1;
+	for (auto _ : state) {
+		readKeys(reads);
+		benchmark::DoNotOptimize(applyKeyReads(reads));
+	}
+	state.SetItemsProcessed(state.iterations() * boundKeys.count);
+	mockLatencyNs = 0;
+}
+BENCHMARK(BM_readKeys)->Arg(0)->Arg(1000)->Arg(20000);
+
+
+//least squares fit of every derived axis for one frame
+//arg = number of derived axes
+void BM_updateDerivedAxes(benchmark::State& state)
+{
+	setupPlugin();
+	for (int i{ 0 }; i < numOfAxes; ++i) {
+		layers[0].inputs[i].type = single;
+		layers[0].inputs[i].keyCode1 = (unsigned short)(4 + i);
+		layers[0].inputs[i].keyNamed1 = false;
+		layers[0].inputs[i].derive = i < state.range(0) ? (i % 2 == 0 ? derive_velocity : derive_acceleration) : derive_none;
+		layers[0].inputs[i].deriveScale = 0.1f;
+	}
+	buildBoundKeys();
+	buildDerivedAxes();
+	long long frameTime = 0;
+	float value = 0.0f;
+	for (auto _ : state) {
+		value = value < 1.0f ? value + 0.01f : 0.0f;
+		std::fill(boundKeys.values, boundKeys.values + boundKeys.count, value);
+		frameTime += 16666667;
+		AnalogKeyboard.sampleTime = frameTime;
+		updateDerivedAxes(AnalogKeyboard, false);
+		benchmark::DoNotOptimize(layers[0].derived.outputs);
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_updateDerivedAxes)->Arg(1)->Arg(6);
+
+
+//fit, extrapolation and error scoring of every predicted axis for one frame
+//arg = number of predicted axes
+void BM_updatePredictedAxes(benchmark::State& state)
+{
+	setupPlugin();
+	for (int i{ 0 }; i < numOfAxes; ++i) {
+		layers[0].inputs[i].type = single;
+		layers[0].inputs[i].keyCode1 = (unsigned short)(4 + i);
+		layers[0].inputs[i].keyNamed1 = false;
+		layers[0].inputs[i].derive = derive_none;
+		layers[0].inputs[i].predictFrames = i < state.range(0) ? 1.5f : 0.0f;
+	}
+	buildBoundKeys();
+	buildPredictedAxes();
+	AnalogKeyboard.frameEstimate = 16666667;
+	long long frameTime = 0;
+	float value = 0.0f;
+	for (auto _ : state) {
+		value = value < 1.0f ? value + 0.01f : 0.0f;
+		std::fill(boundKeys.values, boundKeys.values + boundKeys.count, value);
+		frameTime += 16666667;
+		AnalogKeyboard.sampleTime = frameTime;
+		updatePredictedAxes(AnalogKeyboard, false);
+		benchmark::DoNotOptimize(layers[0].predicted.outputs);
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_updatePredictedAxes)->Arg(1)->Arg(6);
+
+
+//one game frame: callback until SCS_RESULT_not_found
+//arg 0 = keys held still, 1 = every key changes every frame
+void BM_inputEventCallbackFrame(benchmark::State& state)
+{
+	setupPlugin();
+	bool keysMoving = state.range(0) != 0;
+	long long events = 0;
+	float value = 0.5f;
+	scs_input_event_t event;
+	for (auto _ : state) {
+		if (keysMoving) {
+			value = value == 0.5f ? 0.25f : 0.5f;
+			setAllKeys(value);
+			mockKeyValues[4] = 0.0f;
+			mockKeyValues[80] = 0.0f;
+			mockKeyValues[81] = 0.0f;
+		}
+		//the game sets first_in_frame again after each event it receives
+		while (input_event_callback(&event, SCS_INPUT_EVENT_CALLBACK_FLAG_first_in_frame, &registeredDevices[0]) == SCS_RESULT_ok) {
+			++events;
+		}
+	}
+	state.counters["events/s"] = benchmark::Counter(double(events), benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_inputEventCallbackFrame)->Arg(0)->Arg(1);
+
+
+//one game frame with the look axes on their own device, both devices report from one snapshot
+//arg 0 = keys held still, 1 = every key changes every frame
+void BM_splitDevicesFrame(benchmark::State& state)
+{
+	setupPlugin();
+	writeCfg(0, 0, "device 4 = camera\ndevice 5 = camera\n");
+	loadInputs("ats");
+	buildBoundKeys();
+	buildSchedule();
+	buildDerivedAxes();
+	buildPredictedAxes();
+	buildFrameKernel();
+	AnalogKeyboard = device_data_t();
+	buildRegisteredDevices();
+	bool keysMoving = state.range(0) != 0;
+	long long events = 0;
+	float value = 0.5f;
+	scs_input_event_t event;
+	for (auto _ : state) {
+		if (keysMoving) {
+			value = value == 0.5f ? 0.25f : 0.5f;
+			setAllKeys(value);
+			mockKeyValues[4] = 0.0f;
+			mockKeyValues[80] = 0.0f;
+			mockKeyValues[81] = 0.0f;
+		}
+		for (int d{ 0 }; d < registeredDeviceCount; ++d) {
+			while (input_event_callback(&event, SCS_INPUT_EVENT_CALLBACK_FLAG_first_in_frame, &registeredDevices[d]) == SCS_RESULT_ok) {
+				++events;
+			}
+		}
+	}
+	state.counters["events/s"] = benchmark::Counter(double(events), benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_splitDevicesFrame)->Arg(0)->Arg(1);
+
+
+//one game frame with a camera layer on caps lock that moves the truck keys to the look axes
+//arg 0 = layer held, 1 = layer switched every frame
+void BM_layerSwitchFrame(benchmark::State& state)
+{
+	setupPlugin();
+	writeCfg(0, 0, "layer CapsLock\ninput 1 =\ninput 2 =\ninput 5 = Look, 22, 26\n");
+	loadInputs("ats");
+	buildBoundKeys();
+	buildSchedule();
+	buildDerivedAxes();
+	buildPredictedAxes();
+	buildFrameKernel();
+	AnalogKeyboard = device_data_t();
+	buildRegisteredDevices();
+	bool switching = state.range(0) != 0;
+	mockKeyValues[26] = 0.75f;
+	mockKeyValues[57] = 1.0f;
+	long long events = 0;
+	scs_input_event_t event;
+	for (auto _ : state) {
+		if (switching) {
+			mockKeyValues[57] = mockKeyValues[57] == 1.0f ? 0.0f : 1.0f;
+		}
+		while (input_event_callback(&event, SCS_INPUT_EVENT_CALLBACK_FLAG_first_in_frame, &registeredDevices[0]) == SCS_RESULT_ok) {
+			++events;
+		}
+	}
+	state.counters["events/s"] = benchmark::Counter(double(events), benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_layerSwitchFrame)->Arg(0)->Arg(1);
+
+
+//frames fed by the synthetic input generator at 60 fps
+//arg 0 = every configured axis changes every frame, 1 = press/release storm over every key, 2 = mixed waveforms
+void BM_syntheticFrame(benchmark::State& state)
+{
+	setupPlugin();
+	synthReset(1);
+	if (state.range(0) == 0) {
+		synthEveryKeyEveryFrame(boundKeys.codes, boundKeys.count);
+	}
+	else if (state.range(0) == 1) {
+		synthStorm(4, 231, 0.05f);
+	}
+	else {
+		synth_key_t sweep;
+		sweep.wave = synth_sine_sweep;
+		sweep.offset = 0.5f;
+		sweep.amplitude = 0.4f;
+		sweep.freq0 = 0.1f;
+		sweep.freq1 = 2.0f;
+		sweep.period = 20.0f;
+		synthSetKey(26, sweep);
+		synth_key_t pink;
+		pink.wave = synth_pink_noise;
+		pink.offset = 0.2f;
+		pink.amplitude = 0.3f;
+		synthSetKey(4, pink);
+		synthSetKey(7, pink);
+	}
+	long long events = 0;
+	scs_input_event_t event;
+	for (auto _ : state) {
+		synthAdvance(1.0 / 60.0);
+		while (input_event_callback(&event, SCS_INPUT_EVENT_CALLBACK_FLAG_first_in_frame, &registeredDevices[0]) == SCS_RESULT_ok) {
+			++events;
+		}
+	}
+	state.counters["events/s"] = benchmark::Counter(double(events), benchmark::Counter::kIsRate);
+	state.counters["events/frame"] = double(events) / double(state.iterations());
+}
+BENCHMARK(BM_syntheticFrame)->Arg(0)->Arg(1)->Arg(2);
+
+
+//args = setting lines, comment lines
+void BM_importInputs(benchmark::State& state)
+{
+	setupPlugin();
+	writeCfg(int(state.range(0)), int(state.range(1)));
+	for (auto _ : state) {
+		std::ifstream cfg("plugins/WAfAts.cfg");
+		importInputs(cfg, "ats");
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_importInputs)->Args({ 0, 0 })->Args({ 0, 130 })->Args({ 10000, 100000 })->Unit(benchmark::kMicrosecond);
+
+
+//startup with an unchanged cfg, hashes the text and maps plugins/WAfAts.cache with the tables built from it
+//args = setting lines, comment lines
+void BM_loadInputsCached(benchmark::State& state)
+{
+	setupPlugin();
+	writeCfg(int(state.range(0)), int(state.range(1)));
+	loadInputs("ats");
+	buildTables();
+	for (auto _ : state) {
+		loadInputs("ats");
+		buildTables();
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_loadInputsCached)->Args({ 0, 0 })->Args({ 0, 130 })->Args({ 10000, 100000 })->Unit(benchmark::kMicrosecond);
+
+
+void BM_log_line(benchmark::State& state)
+{
+	setupPlugin();
+	int i = 0;
+	for (auto _ : state) {
+		log_line(SCS_LOG_TYPE_message, "imported key1 %i is %u", i, 26u);
+		++i;
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_log_line);
+
+
+BENCHMARK_MAIN();
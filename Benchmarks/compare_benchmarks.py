@@ -0,0 +1,72 @@
+"""
+Compare two Google Benchmark json outputs and flag regressions.
+
+usage: python compare_benchmarks.py baseline.json results.json [--threshold 0.10]
+
+Benchmarks slower than the baseline by more than the threshold are listed as
+regressions and the script exits with 1. Only compare runs from the same machine.
+Runs with --benchmark_repetitions are compared by their medians, which is how
+baseline.json is recorded. A baselined benchmark missing from the results fails
+too, so renaming or dropping one can't quietly lose its coverage.
+"""
+
+import argparse
+import json
+import sys
+
+TIME_UNITS = {"ns": 1.0, "us": 1e3, "ms": 1e6, "s": 1e9}
+
+
+def load(path):
+    with open(path) as file:
+        benchmarks = json.load(file)["benchmarks"]
+    times = {}
+    medians = {}
+    for benchmark in benchmarks:
+        time = benchmark["cpu_time"] * TIME_UNITS[benchmark.get("time_unit", "ns")]
+        if benchmark.get("run_type", "iteration") == "iteration":
+            times[benchmark["run_name"]] = time
+        # mean and stddev rows of repeated runs are skipped, a single slow repetition shouldn't move the result
+        elif benchmark.get("aggregate_name") == "median":
+            medians[benchmark["run_name"]] = time
+    times.update(medians)
+    return times
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("baseline")
+    parser.add_argument("results")
+    parser.add_argument("--threshold", type=float, default=0.10, help="allowed slowdown, 0.10 = 10%%")
+    args = parser.parse_args()
+
+    baseline = load(args.baseline)
+    results = load(args.results)
+
+    regressions = 0
+    print("%-40s %14s %14s %9s" % ("benchmark", "baseline ns", "result ns", "change"))
+    for name, time in results.items():
+        if name not in baseline:
+            print("%-40s %14s %14.1f %9s" % (name, "-", time, "new"))
+            continue
+        change = time / baseline[name] - 1.0
+        flag = ""
+        if change > args.threshold:
+            flag = "  REGRESSION"
+            regressions += 1
+        print("%-40s %14.1f %14.1f %+8.1f%%%s" % (name, baseline[name], time, change * 100.0, flag))
+    missing = 0
+    for name in baseline:
+        if name not in results:
+            print("%-40s %14.1f %14s %9s" % (name, baseline[name], "-", "MISSING"))
+            missing += 1
+
+    if regressions:
+        print("%d benchmark(s) regressed by more than %.0f%%" % (regressions, args.threshold * 100.0))
+    if missing:
+        print("%d baselined benchmark(s) missing from the results, record a new baseline if they were renamed or removed" % missing)
+    return 1 if regressions or missing else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
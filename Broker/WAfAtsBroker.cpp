@@ -0,0 +1,208 @@
+/*
+* WAfAtsBroker, owns the Wooting sdk session and publishes key snapshots for every WAfAts plugin and tool on the machine
+* WAfAtsBroker.exe [--hz 1000] [--affinity 0x4] [--priority normal|above|high|realtime] [--spin-us 50] [--stats-s 60]
+*/
+
+// Windows stuff.
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <timeapi.h>
+
+#include <atomic>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "../WAfAtsBroker.h"
+#include "../WAfAtsSampler.h"
+#include "../WAfAtsStats.h"
+#include "../ScsSdk/include/scssdk.h"
+#include "../WootingSdkWrapper/includes/wooting-analog-wrapper.h"
+
+//max keys taken from one wooting_analog_read_full_buffer call, the whole keyboard
+const int brokerBufferSize = brokerKeys;
+
+std::atomic<bool> brokerStop{ false };
+
+//the stats and sampler code log through this like in the plugin, here it goes to the console
+void log_line(const scs_log_type_t type, const char* const text, ...)
+{
+	va_list args;
+	va_start(args, text);
+	vfprintf(type == SCS_LOG_TYPE_message ? stdout : stderr, text, args);
+	va_end(args);
+	fputc('\n', type == SCS_LOG_TYPE_message ? stdout : stderr);
+}
+
+BOOL WINAPI consoleHandler(DWORD event)
+{
+	if (event == CTRL_C_EVENT || event == CTRL_BREAK_EVENT || event == CTRL_CLOSE_EVENT) {
+		brokerStop.store(true);
+		return TRUE;
+	}
+	return FALSE;
+}
+
+//write the next snapshot, readers retry if they copy it while the seqlock is odd
+void publish(broker_shared_t* shared, HANDLE event, const float* values, int result, unsigned long long sequence)
+{
+	broker_snapshot_t& snapshot = shared->ring[sequence % brokerRingSize];
+	ResetEvent(event);
+	unsigned int lock = snapshot.seqlock.load(std::memory_order_relaxed);
+	snapshot.seqlock.store(lock + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	LARGE_INTEGER now;
+	QueryPerformanceCounter(&now);
+	snapshot.sequence = sequence;
+	snapshot.time = now.QuadPart;
+	snapshot.result = result;
+	memcpy(snapshot.values, values, sizeof(snapshot.values));
+	snapshot.seqlock.store(lock + 2, std::memory_order_release);
+	shared->latest.store(sequence, std::memory_order_release);
+	shared->heartbeat.store(now.QuadPart, std::memory_order_release);
+	SetEvent(event);
+}
+
+int main(int argc, char** argv)
+{
+	int hz = 1000;
+	sampler_settings_t sampler;
+	int spinUs = 50;
+	int statsS = 60;
+	for (int i{ 1 }; i + 1 < argc; i += 2) {
+		if (strcmp(argv[i], "--hz") == 0) {
+			hz = atoi(argv[i + 1]);
+		}
+		else if (strcmp(argv[i], "--affinity") == 0) {
+			sampler.affinity = strtoull(argv[i + 1], NULL, 0);
+		}
+		else if (strcmp(argv[i], "--priority") == 0) {
+			if (!samplerParsePriority(argv[i + 1], sampler.priority)) {
+				fprintf(stderr, "--priority has to be normal, above, high or realtime\n");
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "--spin-us") == 0) {
+			spinUs = atoi(argv[i + 1]);
+		}
+		else if (strcmp(argv[i], "--stats-s") == 0) {
+			statsS = atoi(argv[i + 1]);
+		}
+	}
+	if (hz < 1 || hz > 10000) {
+		fprintf(stderr, "--hz has to be 1 to 10000\n");
+		return 1;
+	}
+	if (spinUs < 0 || spinUs > 1000000 / hz) {
+		fprintf(stderr, "--spin-us has to be 0 to one period\n");
+		return 1;
+	}
+
+	//the mapping can outlive a broker while clients still have it open, so a mutex tells if one is running
+	HANDLE running = CreateMutexA(NULL, FALSE, BROKER_RUNNING_NAME);
+	if (running == NULL || GetLastError() == ERROR_ALREADY_EXISTS) {
+		fprintf(stderr, "another broker is already running\n");
+		return 1;
+	}
+	HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, sizeof(broker_shared_t), BROKER_MAPPING_NAME);
+	if (mapping == NULL) {
+		fprintf(stderr, "unable to create shared memory, error = %lu\n", GetLastError());
+		CloseHandle(running);
+		return 1;
+	}
+	void* view = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, sizeof(broker_shared_t));
+	HANDLE event = CreateEventA(NULL, TRUE, FALSE, BROKER_EVENT_NAME);
+	if (view == NULL || event == NULL) {
+		fprintf(stderr, "unable to map shared memory, error = %lu\n", GetLastError());
+		if (view != NULL) {
+			UnmapViewOfFile(view);
+		}
+		if (event != NULL) {
+			CloseHandle(event);
+		}
+		CloseHandle(mapping);
+		CloseHandle(running);
+		return 1;
+	}
+
+	int devices = wooting_analog_initialise();
+	if (devices < 0) {
+		fprintf(stderr, "wooting analog sdk init failure, error code = %d\n", devices);
+		UnmapViewOfFile(view);
+		CloseHandle(event);
+		CloseHandle(mapping);
+		CloseHandle(running);
+		return 1;
+	}
+	printf("init wooting analog sdk, devices found = %d\n", devices);
+
+	//the magic is written last so a client never sees a half set up header
+	broker_shared_t* shared = static_cast<broker_shared_t*>(view);
+	shared->magic = 0;
+	std::atomic_thread_fence(std::memory_order_release);
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+	shared->version = brokerVersion;
+	shared->frequency = frequency.QuadPart;
+	static float values[brokerKeys] = {};
+	publish(shared, event, values, 0, 0);
+	std::atomic_thread_fence(std::memory_order_release);
+	shared->magic = brokerMagic;
+
+	SetConsoleCtrlHandler(consoleHandler, TRUE);
+	if ((sampler.affinity != 0 || sampler.priority != sampler_priority_normal) && !samplerApply(sampler)) {
+		fprintf(stderr, "unable to set affinity 0x%llx and priority %i\n", sampler.affinity, int(sampler.priority));
+	}
+	sampler_timer_t timer;
+	bool highResolution = samplerTimerOpen(timer, spinUs);
+	if (!highResolution) {
+		//the normal waitable timer only wakes on a timer tick, make those 1 ms
+		timeBeginPeriod(1);
+		fprintf(stderr, "no high resolution timer, expect more jitter\n");
+	}
+	statsInit(statsS, false);
+	printf("publishing at %i Hz, ctrl+c to stop\n", hz);
+
+	unsigned short codes[brokerBufferSize];
+	float buffered[brokerBufferSize];
+	long long period = 1000000000LL / hz;
+	long long next = statsNow();
+	int lastResult = 0;
+	for (unsigned long long sequence{ 1 }; !brokerStop.load(); ++sequence) {
+		//released keys show up once with 0, keys that stay released are left out
+		int result = wooting_analog_read_full_buffer(codes, buffered, brokerBufferSize);
+		for (int j{ 0 }; j < result; ++j) {
+			values[codes[j] % brokerKeys] = buffered[j];
+		}
+		if (result < 0 && result != lastResult) {
+			fprintf(stderr, "failure reading analog keys, error code = %d\n", result);
+		}
+		lastResult = result;
+		publish(shared, event, values, result < 0 ? result : 0, sequence);
+
+		//absolute deadlines so wake up jitter doesn't add up, falling behind skips samples instead of bunching them
+		next += period;
+		long long now = statsNow();
+		if (now > next) {
+			next = now;
+			continue;
+		}
+		statsRecord(stat_sampler_jitter, samplerWaitUntil(timer, next));
+		statsFrameEnd(next);
+	}
+
+	printf("stopping\n");
+	statsShutdown();
+	samplerTimerClose(timer);
+	if (!highResolution) {
+		timeEndPeriod(1);
+	}
+	//plugins see the heartbeat go stale and fall back to the sdk
+	wooting_analog_uninitialise();
+	UnmapViewOfFile(view);
+	CloseHandle(event);
+	CloseHandle(mapping);
+	CloseHandle(running);
+	return 0;
+}
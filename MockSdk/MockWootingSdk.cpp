@@ -0,0 +1,71 @@
+/*
+* Stand-in for wooting_analog_wrapper.dll so the plugin can run without a keyboard
+*/
+
+#include <chrono>
+
+#include "../WootingSdkWrapper/includes/wooting-analog-wrapper.h"
+#include "MockWootingSdk.h"
+
+float mockKeyValues[256] = {};
+long long mockLatencyNs = 0;
+unsigned long long mockReadCount = 0;
+//values last returned by wooting_analog_read_full_buffer
+float mockBufferedValues[256] = {};
+
+void mockWait()
+{
+	if (mockLatencyNs <= 0) {
+		return;
+	}
+	auto end = std::chrono::steady_clock::now() + std::chrono::nanoseconds(mockLatencyNs);
+	while (std::chrono::steady_clock::now() < end) {
+	}
+}
+
+int wooting_analog_initialise(void)
+{
+	return 1;
+}
+
+bool wooting_analog_is_initialised(void)
+{
+	return true;
+}
+
+WootingAnalogResult wooting_analog_uninitialise(void)
+{
+	return WootingAnalogResult_Ok;
+}
+
+WootingAnalogResult wooting_analog_set_keycode_mode(WootingAnalog_KeycodeType mode)
+{
+	return mode == WootingAnalog_KeycodeType_HID ? WootingAnalogResult_Ok : WootingAnalogResult_NotAvailable;
+}
+
+float wooting_analog_read_analog(unsigned short code)
+{
+	++mockReadCount;
+	mockWait();
+	if (code >= 256) {
+		return WootingAnalogResult_InvalidArgument;
+	}
+	return mockKeyValues[code];
+}
+
+int wooting_analog_read_full_buffer(unsigned short* code_buffer, float* analog_buffer, unsigned int len)
+{
+	++mockReadCount;
+	mockWait();
+	unsigned int count = 0;
+	for (unsigned short code{ 0 }; code < 256 && count < len; ++code) {
+		//like the real sdk a released key is reported once with 0
+		if (mockKeyValues[code] > 0 || mockBufferedValues[code] > 0) {
+			code_buffer[count] = code;
+			analog_buffer[count] = mockKeyValues[code];
+			mockBufferedValues[code] = mockKeyValues[code];
+			++count;
+		}
+	}
+	return int(count);
+}
@@ -0,0 +1,12 @@
+/*
+* Stand-in for wooting_analog_wrapper.dll so the plugin can run without a keyboard
+* link MockWootingSdk.cpp instead of wooting_analog_wrapper.dll.lib
+*/
+#pragma once
+
+//analog value returned for each hid code, negative values are returned as error codes
+extern float mockKeyValues[256];
+//busy wait added to every read to simulate a slow sdk
+extern long long mockLatencyNs;
+//number of wooting_analog_read_analog calls so far
+extern unsigned long long mockReadCount;
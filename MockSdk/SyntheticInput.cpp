@@ -0,0 +1,225 @@
+/*
+* Scriptable synthetic key input for MockSdk
+*/
+
+#include "SyntheticInput.h"
+#include "MockWootingSdk.h"
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+const int synthKeyCount = 256;
+const double synthPi = 3.14159265358979323846;
+
+synth_key_t synthKeys[synthKeyCount];
+uint32_t synthRandomState = 1;
+unsigned long long synthAdvances = 0;
+double synthTime = 0;
+
+//xorshift32, same sequence on every compiler unlike the std distributions
+uint32_t synthRandom()
+{
+	uint32_t x = synthRandomState;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	synthRandomState = x;
+	return x;
+}
+
+//uniform 0 to 1
+float synthRandomUnit()
+{
+	return float(synthRandom() >> 8) * (1.0f / 16777216.0f);
+}
+
+float clampUnit(float value)
+{
+	return value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+}
+
+void synthReset(uint32_t seed)
+{
+	for (int i{ 0 }; i < synthKeyCount; ++i) {
+		synthKeys[i] = synth_key_t();
+		mockKeyValues[i] = 0.0f;
+	}
+	//xorshift gets stuck on 0
+	synthRandomState = seed != 0 ? seed : 1;
+	synthAdvances = 0;
+	synthTime = 0;
+}
+
+void synthSetKey(unsigned short code, const synth_key_t& key)
+{
+	if (code < synthKeyCount) {
+		synthKeys[code] = key;
+	}
+}
+
+float synthValue(synth_key_t& key, double seconds)
+{
+	switch (key.wave) {
+	case synth_constant:
+		return key.offset;
+	case synth_sine_sweep: {
+		double sweep = std::fmod(synthTime, double(key.period)) / key.period;
+		double frequency = key.freq0 + (key.freq1 - key.freq0) * sweep;
+		key.phase = std::fmod(key.phase + 2.0 * synthPi * frequency * seconds, 2.0 * synthPi);
+		return key.offset + key.amplitude * float(std::sin(key.phase));
+	}
+	case synth_step:
+		return std::fmod(synthTime, double(key.period)) < key.period * 0.5 ? key.offset : key.offset + key.amplitude;
+	case synth_ramp:
+		return key.offset + key.amplitude * float(std::fmod(synthTime, double(key.period)) / key.period);
+	case synth_white_noise:
+		return key.offset + key.amplitude * (synthRandomUnit() * 2.0f - 1.0f);
+	case synth_pink_noise: {
+		//paul kellet's economy 1/f filter over white noise
+		float white = synthRandomUnit() * 2.0f - 1.0f;
+		key.pink[0] = 0.99765f * key.pink[0] + white * 0.0990460f;
+		key.pink[1] = 0.96300f * key.pink[1] + white * 0.2965164f;
+		key.pink[2] = 0.57000f * key.pink[2] + white * 1.0526913f;
+		float pink = (key.pink[0] + key.pink[1] + key.pink[2] + white * 0.1848f) * 0.25f;
+		return key.offset + key.amplitude * pink;
+	}
+	case synth_storm:
+		if (synthRandomUnit() < key.chance) {
+			key.pressed = !key.pressed;
+		}
+		return key.pressed ? 1.0f : 0.0f;
+	case synth_toggle:
+		return synthAdvances % 2 == 0 ? key.offset : key.offset + key.amplitude;
+	default:
+		return 0.0f;
+	}
+}
+
+void synthAdvance(double seconds)
+{
+	synthTime += seconds;
+	for (int i{ 0 }; i < synthKeyCount; ++i) {
+		if (synthKeys[i].wave != synth_off) {
+			mockKeyValues[i] = clampUnit(synthValue(synthKeys[i], seconds));
+		}
+	}
+	++synthAdvances;
+}
+
+void synthStorm(unsigned short firstCode, unsigned short lastCode, float chance)
+{
+	synth_key_t key;
+	key.wave = synth_storm;
+	key.chance = chance;
+	for (unsigned short code{ firstCode }; code <= lastCode && code < synthKeyCount; ++code) {
+		synthSetKey(code, key);
+	}
+}
+
+void synthEveryKeyEveryFrame(const unsigned short* codes, int count)
+{
+	//unique levels keep the two keys of a dual axis apart so the shared axis can't cancel out to 0
+	for (int i{ 0 }; i < count; ++i) {
+		synth_key_t key;
+		key.wave = synth_toggle;
+		key.offset = 0.05f + 0.9f * float(i) / float(count);
+		key.amplitude = 0.45f / float(count);
+		synthSetKey(codes[i], key);
+	}
+}
+
+bool synthLoadScript(const char* path)
+{
+	std::ifstream script(path);
+	if (!script.good()) {
+		printf("can't open synthetic input script %s\n", path);
+		return false;
+	}
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(script, line)) {
+		++lineNumber;
+		line = line.substr(0, line.find('#'));
+		std::istringstream tokens(line);
+		std::string codes;
+		std::string wave;
+		if (!(tokens >> codes)) {
+			continue;
+		}
+		if (codes == "seed") {
+			uint32_t seed = 0;
+			if (!(tokens >> seed)) {
+				printf("%s:%i: seed needs a number\n", path, lineNumber);
+				return false;
+			}
+			synthReset(seed);
+			continue;
+		}
+
+		unsigned int firstCode = 0;
+		unsigned int lastCode = 0;
+		int parsed = sscanf_s(codes.c_str(), "%u-%u", &firstCode, &lastCode);
+		if (parsed < 1 || !(tokens >> wave)) {
+			printf("%s:%i: expected '<code> <wave> ...'\n", path, lineNumber);
+			return false;
+		}
+		if (parsed == 1) {
+			lastCode = firstCode;
+		}
+
+		synth_key_t key;
+		bool ok = true;
+		if (wave == "constant") {
+			key.wave = synth_constant;
+			ok = bool(tokens >> key.offset);
+		}
+		else if (wave == "sine_sweep") {
+			key.wave = synth_sine_sweep;
+			ok = bool(tokens >> key.offset >> key.amplitude >> key.freq0 >> key.freq1 >> key.period);
+		}
+		else if (wave == "step") {
+			key.wave = synth_step;
+			ok = bool(tokens >> key.offset >> key.amplitude >> key.period);
+		}
+		else if (wave == "ramp") {
+			key.wave = synth_ramp;
+			ok = bool(tokens >> key.offset >> key.amplitude >> key.period);
+		}
+		else if (wave == "white") {
+			key.wave = synth_white_noise;
+			ok = bool(tokens >> key.offset >> key.amplitude);
+		}
+		else if (wave == "pink") {
+			key.wave = synth_pink_noise;
+			ok = bool(tokens >> key.offset >> key.amplitude);
+		}
+		else if (wave == "storm") {
+			key.wave = synth_storm;
+			ok = bool(tokens >> key.chance);
+		}
+		else if (wave == "toggle") {
+			unsigned short toggled[synthKeyCount];
+			int count = 0;
+			for (unsigned int code{ firstCode }; code <= lastCode && code < synthKeyCount; ++code) {
+				toggled[count++] = (unsigned short)code;
+			}
+			synthEveryKeyEveryFrame(toggled, count);
+			continue;
+		}
+		else {
+			printf("%s:%i: unknown wave '%s'\n", path, lineNumber, wave.c_str());
+			return false;
+		}
+		if (!ok || key.period <= 0) {
+			printf("%s:%i: missing or bad parameters for %s\n", path, lineNumber, wave.c_str());
+			return false;
+		}
+		for (unsigned int code{ firstCode }; code <= lastCode && code < synthKeyCount; ++code) {
+			synthSetKey((unsigned short)code, key);
+		}
+	}
+	return true;
+}
@@ -0,0 +1,67 @@
+/*
+* Scriptable synthetic key input for MockSdk
+* each advance writes the generated values to mockKeyValues, so the plugin sees them through the normal sdk reads
+* a fixed seed always produces the same sequence
+*/
+#pragma once
+
+#include <cstdint>
+
+enum synthWave {
+	synth_off,
+	//offset
+	synth_constant,
+	//offset + amplitude * sin, frequency sweeping from freq0 to freq1 every period
+	synth_sine_sweep,
+	//offset while in the first half of period, offset + amplitude in the second
+	synth_step,
+	//offset to offset + amplitude over period then back to offset
+	synth_ramp,
+	//offset + amplitude * uniform noise in -1 to 1
+	synth_white_noise,
+	//offset + amplitude * 1/f noise
+	synth_pink_noise,
+	//fully pressed or released, flipped with probability chance on every advance
+	synth_storm,
+	//offset and offset + amplitude on alternating advances, changes every frame
+	synth_toggle,
+};
+
+struct synth_key_t
+{
+	synthWave wave = synth_off;
+	float offset = 0;
+	float amplitude = 0;
+	float period = 1;
+	float freq0 = 0;
+	float freq1 = 0;
+	float chance = 0;
+	//generator state
+	double phase = 0;
+	float pink[3] = { 0, 0, 0 };
+	bool pressed = false;
+};
+
+//clear every key and restart the random sequence
+void synthReset(uint32_t seed);
+void synthSetKey(unsigned short code, const synth_key_t& key);
+//move the generators forward and write their values to mockKeyValues
+void synthAdvance(double seconds);
+
+//storm of random presses and releases over a range of hid codes
+void synthStorm(unsigned short firstCode, unsigned short lastCode, float chance);
+//every key toggles every advance at a level unique to the key, so any axis built from them changes every frame
+void synthEveryKeyEveryFrame(const unsigned short* codes, int count);
+
+//load a scenario script, returns false and prints the bad line if it can't be parsed
+//one command per line, # starts a comment, code can be a single hid code or a range like 4-29
+//  seed <n>
+//  <code> constant <offset>
+//  <code> sine_sweep <offset> <amplitude> <freq0> <freq1> <period>
+//  <code> step <offset> <amplitude> <period>
+//  <code> ramp <offset> <amplitude> <period>
+//  <code> white <offset> <amplitude>
+//  <code> pink <offset> <amplitude>
+//  <code> storm <chance>
+//  <code> toggle
+bool synthLoadScript(const char* path);
@@ -12,6 +12,15 @@
 
 #include <string>
 #include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 // SDK
 #include "ScsSdk/include/scssdk_input.h"
@@ -21,207 +30,2745 @@
 #include "ScsSdk/include/amtrucks/scssdk_input_ats.h"
 #include "WootingSdkWrapper/includes/wooting-analog-wrapper.h"
 
+#include "WAfAtsBroker.h"
+#include "WAfAtsCalibration.h"
+#include "WAfAtsControl.h"
+#include "WAfAtsHeap.h"
+#include "WAfAtsKernel.h"
+#include "WAfAtsKeys.h"
+#include "WAfAtsRecording.h"
+#include "WAfAtsSampler.h"
+#include "WAfAtsStats.h"
+#include "WAfAtsTelemetry.h"
+#include "WAfAtsTrace.h"
+
 
 #define UNUSED(x)
 
-scs_log_t game_log = NULL;
+scs_log_t game_log = NULL;
+
+//game only has 6 axes to set, 3 single and 3 dual
+//gas, brake, clutch, steer, lookup, lookright
+//should be safe to change if needed(just make sure your imported cfg is adapted as it will try to read more lines)
+const int numOfAxes = 6;
+
+//the base layer and up to 3 more held with modifier keys, set with 'layer <key>' sections in the cfg
+const int maxLayers = 4;
+
+//every axis can use at most 2 keys per layer, all layers and their modifier keys share the bits of a key mask
+const int maxBoundKeys = 32;
+
+static_assert(numOfAxes <= kernelLanes, "every axis needs a lane of the frame kernel");
+static_assert(maxBoundKeys <= recordingMaxKeys, "every bound key needs a value in recorded frames");
+
+// Prints message to game log.
+// SCS_LOG_TYPE_message, SCS_LOG_TYPE_warning, SCS_LOG_TYPE_error
+void log_line(const scs_log_type_t type, const char* const text, ...)
+{
+	if (!game_log) {
+		return;
+	}
+	TRACE_SPAN("log_line");
+	char formated[1000];
+
+	va_list args;
+	va_start(args, text);
+	vsnprintf_s(formated, sizeof(formated), _TRUNCATE, text, args);
+	formated[sizeof(formated) - 1] = 0;
+	va_end(args);
+
+	//prefix all of our messages
+	char temp[1000] = "[plugin][WAfAts] ";
+	strcat_s(temp, formated);
+	//whatever the game does with it is its business
+	HEAP_CHECK_PAUSE();
+	game_log(type, temp);
+}
+
+
+//the keyboard snapshot of a frame, shared by every registered device
+struct device_data_t
+{
+	float lastReportedInputValues[numOfAxes] = { 0,0,0,0,0,0 };
+	//when the snapshot was taken and when the keys were read
+	long long frameStart = 0;
+	long long sampleTime = 0;
+	int sdkReadsInFrame = 0;
+	//snapshots taken, a registered device starting its frame takes a new one if it already used this one
+	unsigned int snapshot = 0;
+	//counts frames for the update rate tiers
+	unsigned int frameNumber = 0;
+	//bits of the axes evaluated this frame
+	unsigned int dueAxes = 0;
+	//report every axis again in the next frame, after a pause or activation
+	bool resync = true;
+	//slew limiter per axis: where the output is heading, the output it starts from this frame,
+	//the time it gets to move and when it last moved
+	float slewTargets[numOfAxes] = {};
+	float slewFrom[numOfAxes] = {};
+	float slewSeconds[numOfAxes] = {};
+	long long slewTimes[numOfAxes] = {};
+	//ns between frames, learned from the spacing of frame starts, 0 until there were two
+	long long frameEstimate = 0;
+	long long lastFrameStart = 0;
+};
+
+device_data_t AnalogKeyboard;
+
+//clock of frame starts and sample times, the analyzer replays recordings on the recorded times
+long long (*sampleClock)() = statsNow;
+
+//one scs input device, axes are split over several with 'device N = <name>' so each has its own event loop
+//the first one called in a frame reads the keyboard for all of them
+struct registered_device_t
+{
+	//registered as 'wootdevice' for axes without a device setting, 'woot_<name>' for the others
+	std::string name;
+	std::string displayName;
+	//bits of the axes on this device, axis i is input inputIndex[i] of the device
+	unsigned int axes = 0;
+	int inputCount = 0;
+	int inputIndex[numOfAxes] = {};
+	//snapshot the current frame reports from
+	unsigned int snapshot = 0;
+	//bits of the axes still to report this frame, their values are in the outputs of the active layer's kernel
+	unsigned int changedAxes = 0;
+	int nextReportedAxis = 0;
+	int nextReportedInput = 0;
+	//for stats, frameStart is -1 between frames
+	long long frameStart = -1;
+	int eventsInFrame = 0;
+};
+
+registered_device_t registeredDevices[numOfAxes];
+int registeredDeviceCount = 0;
+
+//how many keys for each input axis
+enum inputAxisType {
+	disabled,
+	single,
+	dual,
+};
+
+//slowest update rate tier, in frames
+const int maxRatePeriod = 60;
+//furthest a predicted axis looks ahead, in frames
+const float maxPredictFrames = 4.0f;
+//widest deadzone, in key travel
+const float maxDeadzone = 0.5f;
+
+//how hard an axis responds at different truck speeds, set with 'speed_response N = ...' in the cfg
+//each band maps key travel to output with gain * travel^exponent, sampled into a table when the cfg is loaded
+//at frame time the output is interpolated between the tables of the two bands around the current speed
+struct speed_response_t
+{
+	int bands = 0;
+	//ascending, in the unit set by speed_unit
+	float speeds[maxSpeedBands] = {};
+	//as given in the cfg, so the bands can be written back
+	float gains[maxSpeedBands] = {};
+	float exponents[maxSpeedBands] = {};
+	float tables[maxSpeedBands][responseTableSize] = {};
+};
+
+//report how fast a key moves instead of where it is, set with 'derive N = velocity|acceleration'
+enum inputDerive {
+	derive_none,
+	derive_velocity,
+	derive_acceleration,
+};
+
+struct inputData
+{
+	std::string displayName{ "unnamed axis" };
+	unsigned short keyCode1{ 0 };
+	unsigned short keyCode2{ 0 };
+	inputAxisType type{ disabled };
+	//key given by name instead of a code in keycode_mode
+	bool keyNamed1{ false };
+	bool keyNamed2{ false };
+	//physical keys after keycode_mode translation, these are the keys read
+	unsigned short hidCode1{ 0 };
+	unsigned short hidCode2{ 0 };
+	//index of hidCode1/hidCode2 in boundKeys
+	int keyIndex1{ -1 };
+	int keyIndex2{ -1 };
+	speed_response_t speedResponse;
+	//update rate tier set with 'rate N = ...', read every ratePeriod frames starting at ratePhase
+	int ratePeriod{ 1 };
+	int ratePhase{ 0 };
+	//only evaluate when the keyboard reports one of its keys moved
+	bool rateOnChange{ false };
+	//bits of boundKeys used by this axis
+	unsigned int keyMask{ 0 };
+	inputDerive derive{ derive_none };
+	//output per travel/s or travel/s^2, clamped to -1 to 1
+	float deriveScale{ 0.0f };
+	//max output change per second away from and back towards center, 0 = no limit
+	float slewRise{ 0.0f };
+	float slewFall{ 0.0f };
+	//report where the axis will be this many frames after the sample, 0 = off
+	float predictFrames{ 0.0f };
+	//most a prediction may lead the last sample by, so also the most it overshoots when a key stops or is released
+	float predictOvershoot{ 0.1f };
+	//travel that reports 0, the rest is stretched back to 0 to 1, applied in the frame kernel before the speed response
+	float deadzone{ 0.0f };
+	//registered device the axis is on, set with 'device N = <name>', empty = wootdevice
+	std::string device;
+};
+
+//samples in the least squares fit of derived axes, about 130 ms at 60 fps
+const int derivativeWindow = 8;
+
+//rings of the last samples of every derived axis, all pushed in the same frame so they share one time ring
+struct derived_axes_t
+{
+	int count = 0;
+	//index of each derived axis in the inputs of its layer
+	int axes[numOfAxes] = {};
+	int head = 0;
+	long long times[derivativeWindow] = {};
+	float values[numOfAxes][derivativeWindow] = {};
+	//indexed by axis like lastReportedInputValues
+	float outputs[numOfAxes] = {};
+};
+
+//samples in the fit of predicted axes, short so a key stopping shows in the slope within a couple of frames
+const int predictWindow = 4;
+//predictions waiting for the samples around their target time to score them
+const int maxPendingPredictions = 8;
+
+struct pending_prediction_t
+{
+	long long target = 0;
+	float predicted = 0.0f;
+	//the newest sample when it was made, what the axis would have reported without prediction
+	float held = 0.0f;
+};
+
+//rings of the last samples of every predicted axis, all pushed in the same frame so they share one time ring
+struct predicted_axes_t
+{
+	int count = 0;
+	//index of each predicted axis in the inputs of its layer
+	int axes[numOfAxes] = {};
+	int head = 0;
+	long long times[predictWindow] = {};
+	float values[numOfAxes][predictWindow] = {};
+	//oldest first
+	pending_prediction_t pending[numOfAxes][maxPendingPredictions] = {};
+	int pendingCount[numOfAxes] = {};
+	//indexed by axis like lastReportedInputValues
+	float outputs[numOfAxes] = {};
+};
+
+//sorted unique keys used by the layers, each one is read at most once per frame
+struct bound_keys_t
+{
+	int count = 0;
+	unsigned short codes[maxBoundKeys] = {};
+	//one more that stays 0 for the missing key of single and disabled axes
+	float values[maxBoundKeys + 1] = {};
+	//indices into codes, modifier keys first, then keys of every frame axes so driving keys are read before camera keys
+	int readOrder[maxBoundKeys] = {};
+	//bits of the modifier keys, read every frame whatever the layer
+	unsigned int modifierMask = 0;
+};
+
+bound_keys_t boundKeys;
+
+//the 6 axes bound and processed one way, with everything the frame needs built at load
+//a held modifier key switches layers by changing activeLayer, nothing is rebuilt or allocated
+struct axis_layer_t
+{
+	//key held for this layer, unused by the base layer
+	unsigned short modifierCode = 0;
+	bool modifierNamed = false;
+	//physical key after keycode_mode translation
+	unsigned short modifierHid = 0;
+	//index of the modifier's physical key in boundKeys
+	int modifierIndex = -1;
+	inputData inputs[numOfAxes];
+	//bits of the axes with at least one key
+	unsigned int activeMask = 0;
+	//bits of the on change axes using each key of boundKeys
+	unsigned int onChangeAxes[maxBoundKeys] = {};
+	frame_kernel_t kernel;
+	derived_axes_t derived;
+	predicted_axes_t predicted;
+};
+
+//layers[0] is the base layer from the input lines at the top of the cfg
+axis_layer_t layers[maxLayers];
+int layerCount = 1;
+//layer the axes are read and evaluated with
+int activeLayer = 0;
+
+//optional 'name = value' lines between the inputs and the comment block of the cfg
+struct plugin_settings_t
+{
+	bool trace = false;
+	//write the trace as soon as a frame takes this long, 0 = only on shutdown
+	int traceTriggerUs = 0;
+	//run sdk reads on a worker and wait at most this long for them, 0 = read on the game thread
+	int guardedReadUs = 0;
+	//timeouts in a row before we stop waiting for the sdk and hold the last good values
+	int guardedReadMaxTimeouts = 30;
+	//seconds between stats summaries in the game log, 0 = only on shutdown
+	int statsSummaryS = 300;
+	//also write the stats to plugins/WAfAts.stats.txt with every summary
+	bool statsExport = false;
+	//telemetry speed is in m/s, speed_response bands are in km/h unless 'speed_unit = mph'
+	float speedUnitScale = 3.6f;
+	//stop reading the keyboard while the game is paused
+	bool pauseSampling = true;
+	//what the key codes in the cfg are, translated to hid codes once at load so every read stays a plain hid read
+	WootingAnalog_KeycodeType keycodeMode = WootingAnalog_KeycodeType_HID;
+	//learn where every key rests and tops out and stretch that to 0 to 1
+	bool calibrate = false;
+	//write the key values of every frame to plugins/WAfAts.rec for the analyzer
+	bool record = false;
+	//take tuning commands on the control pipe while driving
+	bool control = false;
+	//the profile that was picked, where the control pipe saves changes to
+	char profile[32] = {};
+	//read key snapshots from a running WAfAtsBroker instead of opening our own sdk session
+	bool broker = false;
+	//fastest frame kernel allowed, the best one the cpu has up to this is used
+	frameKernelLevel frameKernel = kernel_avx2;
+	//cpus and priority of the guarded reader's worker, set with 'sampler_affinity' and 'sampler_priority'
+	sampler_settings_t sampler;
+	//travel a modifier key needs to switch to its layer, it stays in the layer until it falls below half of this
+	float layerThreshold = 0.5f;
+};
+
+plugin_settings_t settings;
+
+void sanitize(std::string& string, const char* whitelist)
+{
+	int badChar = string.find_first_not_of(whitelist);
+	while (badChar >= 0) {
+		string.erase(badChar, 1);
+		badChar = string.find_first_not_of(whitelist);
+	}
+}
+
+//parse 'speed gain exponent, speed gain exponent, ...' into response tables
+bool importSpeedResponse(speed_response_t& response, const std::string& value)
+{
+	response = speed_response_t();
+	size_t start = 0;
+	while (start < value.size() && response.bands < maxSpeedBands) {
+		size_t end = value.find(',', start);
+		if (end == std::string::npos) {
+			end = value.size();
+		}
+		float speed, gain, exponent;
+		if (sscanf_s(value.substr(start, end - start).c_str(), "%f %f %f", &speed, &gain, &exponent) != 3 || exponent <= 0) {
+			return false;
+		}
+		if (response.bands > 0 && speed <= response.speeds[response.bands - 1]) {
+			return false;
+		}
+		response.speeds[response.bands] = speed;
+		response.gains[response.bands] = gain;
+		response.exponents[response.bands] = exponent;
+		for (int i{ 0 }; i < responseTableSize; ++i) {
+			float travel = float(i) / float(responseTableSize - 1);
+			float output = gain * std::pow(travel, exponent);
+			response.tables[response.bands][i] = output < 1.0f ? output : 1.0f;
+		}
+		++response.bands;
+		start = end + 1;
+	}
+	return response.bands > 0;
+}
+
+//cfg text filters
+const char whitelist[] = "qwertyuiopasdfghjklzxcvbnmQWERTYUIOPASDFGHJKLZXCVBNM1234567890 ._";
+const char whitelistNum[] = "1234567890";
+const char whitelistKey[] = "qwertyuiopasdfghjklzxcvbnmQWERTYUIOPASDFGHJKLZXCVBNM1234567890-_";
+//scs device names
+const char whitelistDevice[] = "qwertyuiopasdfghjklzxcvbnm1234567890_";
+//longest device name with its terminator, as kept in the cache
+const int maxDeviceName = 16;
+
+//read a sanitized key as a code or a key name without complaining, false if it is neither
+bool parseKey(const std::string& key, unsigned short& keyCode, bool& named)
+{
+	if (key.empty()) {
+		return false;
+	}
+	named = key.find_first_not_of(whitelistNum) != std::string::npos;
+	if (!named) {
+		keyCode = stoi(key);
+		return true;
+	}
+	//scan codes and virtual keys are usually written in hex
+	if (key.size() > 2 && key.size() <= 6 && key.compare(0, 2, "0x") == 0 && key.find_first_not_of("0123456789abcdefABCDEF", 2) == std::string::npos) {
+		named = false;
+		keyCode = (unsigned short)strtol(key.c_str() + 2, NULL, 16);
+		return true;
+	}
+	int code = keyCodeFromName(key);
+	if (code < 0) {
+		return false;
+	}
+	keyCode = (unsigned short)code;
+	return true;
+}
+
+//read a key as a code or a key name, false if it is neither
+bool importKey(const char* token, unsigned short& keyCode, bool& named)
+{
+	std::string key = token;
+	sanitize(key, whitelistKey);
+	if (parseKey(key, keyCode, named)) {
+		return true;
+	}
+	if (!key.empty() && named) {
+		log_line(SCS_LOG_TYPE_warning, "unknown key '%s' in cfg file, did you mean '%s'?", key.c_str(), nearestKeyName(key));
+	}
+	return false;
+}
+const char whitelistSetting[] = "qwertyuiopasdfghjklzxcvbnmQWERTYUIOPASDFGHJKLZXCVBNM1234567890 ._,-";
+
+//parse 'name, key1, key2' into an input
+void importInput(inputData& input, char* lineString)
+{
+	const char separators[] = ",";
+	std::string tempString;
+	char* token = NULL;
+	char* nextToken = NULL;
+
+	token = strtok_s(lineString, separators, &nextToken);
+	//assign name
+	if (token != NULL)
+	{
+		tempString = token;
+		sanitize(tempString, whitelist);
+		if (!tempString.empty()) {
+			input.displayName = tempString;
+		}
+		token = strtok_s(NULL, separators, &nextToken);
+	}
+	//assign key1
+	if (token != NULL)
+	{
+		if (importKey(token, input.keyCode1, input.keyNamed1)) {
+			input.type = single;
+		}
+		token = strtok_s(NULL, separators, &nextToken);
+	}
+	//assign key2
+	if (token != NULL)
+	{
+		if (importKey(token, input.keyCode2, input.keyNamed2)) {
+			input.type = dual;
+		}
+	}
+}
+
+//per input settings that can also be changed while driving on the control pipe
+const char* const tuningNames[] = { "slew", "predict", "predict_overshoot", "derive_scale", "speed_response", "deadzone" };
+
+bool isTuning(const std::string& name)
+{
+	for (const char* tuning : tuningNames) {
+		if (name == tuning) {
+			return true;
+		}
+	}
+	return false;
+}
+
+//apply the value of a tuning setting to an input, false with what was wrong in error if it is bad
+bool importTuning(inputData& input, const std::string& name, const std::string& value, std::string& error)
+{
+	char message[200];
+	if (name == "slew") {
+		float rise = 0.0f;
+		float fall = 0.0f;
+		int count = sscanf_s(value.c_str(), "%f %f", &rise, &fall);
+		if (count < 1 || rise < 0.0f || fall < 0.0f) {
+			snprintf(message, sizeof(message), "bad slew '%s', expected 'rise fall' in units per second", value.c_str());
+			error = message;
+			return false;
+		}
+		input.slewRise = rise;
+		input.slewFall = count > 1 ? fall : rise;
+	}
+	else if (name == "predict") {
+		float frames = float(atof(value.c_str()));
+		if (frames < 0.0f || frames > maxPredictFrames) {
+			snprintf(message, sizeof(message), "bad predict '%s', expected 0 to %.0f frames", value.c_str(), maxPredictFrames);
+			error = message;
+			return false;
+		}
+		input.predictFrames = frames;
+	}
+	else if (name == "predict_overshoot") {
+		float overshoot = float(atof(value.c_str()));
+		if (overshoot < 0.0f) {
+			snprintf(message, sizeof(message), "bad predict_overshoot '%s', expected travel 0 or more", value.c_str());
+			error = message;
+			return false;
+		}
+		input.predictOvershoot = overshoot;
+	}
+	else if (name == "derive_scale") {
+		input.deriveScale = float(atof(value.c_str()));
+	}
+	else if (name == "speed_response") {
+		speed_response_t response;
+		if (!importSpeedResponse(response, value)) {
+			snprintf(message, sizeof(message), "bad speed_response '%s', expected 'speed gain exponent' bands with rising speeds", value.c_str());
+			error = message;
+			return false;
+		}
+		input.speedResponse = response;
+	}
+	else if (name == "deadzone") {
+		float deadzone = float(atof(value.c_str()));
+		if (deadzone < 0.0f || deadzone > maxDeadzone) {
+			snprintf(message, sizeof(message), "bad deadzone '%s', expected travel 0 to %g", value.c_str(), maxDeadzone);
+			error = message;
+			return false;
+		}
+		input.deadzone = deadzone;
+	}
+	else {
+		error = "unknown setting '" + name + "'";
+		return false;
+	}
+	return true;
+}
+
+//apply a single 'name = value' line from the cfg to a layer
+//'name N' settings apply to the input on line N of the cfg, layers other than the base one only take those
+void importSetting(int layer, const std::string& fullName, const std::string& value)
+{
+	std::string name = fullName;
+	int axis = -1;
+	size_t space = fullName.find_last_of(' ');
+	if (space != std::string::npos) {
+		name = fullName.substr(0, space);
+		axis = atoi(fullName.c_str() + space + 1) - 1;
+		if (axis < 0 || axis >= numOfAxes) {
+			log_line(SCS_LOG_TYPE_warning, "setting '%s' needs an input line between 1 and %i", fullName.c_str(), numOfAxes);
+			return;
+		}
+	}
+	inputData* inputs = layers[layer].inputs;
+	if (axis < 0 && layer > 0) {
+		log_line(SCS_LOG_TYPE_warning, "setting '%s' is not per input, it can't go in a layer", fullName.c_str());
+		return;
+	}
+
+	if (axis >= 0) {
+		if (name == "input") {
+			//same as the input lines at the top, so a profile can rebind keys
+			inputData& input = inputs[axis];
+			std::string line = value;
+			input.displayName = inputData().displayName;
+			input.keyCode1 = 0;
+			input.keyCode2 = 0;
+			input.keyNamed1 = false;
+			input.keyNamed2 = false;
+			input.type = disabled;
+			importInput(input, &line[0]);
+		}
+		else if (name == "rate") {
+			inputData& input = inputs[axis];
+			input.ratePeriod = 1;
+			input.rateOnChange = value == "change";
+			if (!input.rateOnChange) {
+				int period = atoi(value.c_str());
+				if (period < 1 || period > maxRatePeriod) {
+					log_line(SCS_LOG_TYPE_warning, "bad rate '%s', expected 1 to %i frames or 'change'", value.c_str(), maxRatePeriod);
+					return;
+				}
+				input.ratePeriod = period;
+			}
+		}
+		else if (name == "derive") {
+			inputData& input = inputs[axis];
+			if (value == "velocity") {
+				input.derive = derive_velocity;
+				input.deriveScale = input.deriveScale != 0.0f ? input.deriveScale : 0.1f;
+			}
+			else if (value == "acceleration") {
+				input.derive = derive_acceleration;
+				input.deriveScale = input.deriveScale != 0.0f ? input.deriveScale : 0.002f;
+			}
+			else if (value == "none") {
+				input.derive = derive_none;
+			}
+			else {
+				log_line(SCS_LOG_TYPE_warning, "bad derive '%s', expected velocity, acceleration or none", value.c_str());
+				return;
+			}
+		}
+		else if (name == "device") {
+			//the game gets the devices once at load, a layer can't move an axis to another one
+			if (layer > 0) {
+				log_line(SCS_LOG_TYPE_warning, "setting '%s' can't go in a layer", fullName.c_str());
+				return;
+			}
+			std::string device = value;
+			sanitize(device, whitelistDevice);
+			if (device.size() >= maxDeviceName || device != value) {
+				log_line(SCS_LOG_TYPE_warning, "bad device '%s', expected up to %i lowercase letters, digits or _", value.c_str(), maxDeviceName - 1);
+				return;
+			}
+			inputs[axis].device = device;
+		}
+		else if (isTuning(name)) {
+			std::string error;
+			if (!importTuning(inputs[axis], name, value, error)) {
+				log_line(SCS_LOG_TYPE_warning, "%s", error.c_str());
+				return;
+			}
+		}
+		else {
+			log_line(SCS_LOG_TYPE_warning, "unknown setting '%s' in cfg file", fullName.c_str());
+			return;
+		}
+	}
+	else if (name == "broker") {
+		settings.broker = atoi(value.c_str()) != 0;
+	}
+	else if (name == "calibrate") {
+		settings.calibrate = atoi(value.c_str()) != 0;
+	}
+	else if (name == "record") {
+		settings.record = atoi(value.c_str()) != 0;
+	}
+	else if (name == "control") {
+		settings.control = atoi(value.c_str()) != 0;
+	}
+	else if (name == "pause_sampling") {
+		settings.pauseSampling = atoi(value.c_str()) != 0;
+	}
+	else if (name == "keycode_mode") {
+		if (value == "hid") {
+			settings.keycodeMode = WootingAnalog_KeycodeType_HID;
+		}
+		else if (value == "scancode1") {
+			settings.keycodeMode = WootingAnalog_KeycodeType_ScanCode1;
+		}
+		else if (value == "virtualkey") {
+			settings.keycodeMode = WootingAnalog_KeycodeType_VirtualKey;
+		}
+		else if (value == "virtualkey_translate") {
+			settings.keycodeMode = WootingAnalog_KeycodeType_VirtualKeyTranslate;
+		}
+		else {
+			log_line(SCS_LOG_TYPE_warning, "bad keycode_mode '%s', expected hid, scancode1, virtualkey or virtualkey_translate", value.c_str());
+			return;
+		}
+	}
+	else if (name == "frame_kernel") {
+		if (value == "auto" || value == "avx2") {
+			settings.frameKernel = kernel_avx2;
+		}
+		else if (value == "sse2") {
+			settings.frameKernel = kernel_sse2;
+		}
+		else if (value == "scalar") {
+			settings.frameKernel = kernel_scalar;
+		}
+		else {
+			log_line(SCS_LOG_TYPE_warning, "bad frame_kernel '%s', expected auto, avx2, sse2 or scalar", value.c_str());
+			return;
+		}
+	}
+	else if (name == "sampler_affinity") {
+		settings.sampler.affinity = strtoull(value.c_str(), NULL, 0);
+	}
+	else if (name == "sampler_priority") {
+		if (!samplerParsePriority(value.c_str(), settings.sampler.priority)) {
+			log_line(SCS_LOG_TYPE_warning, "bad sampler_priority '%s', expected normal, above, high or realtime", value.c_str());
+			return;
+		}
+	}
+	else if (name == "layer_threshold") {
+		float threshold = float(atof(value.c_str()));
+		if (threshold <= 0.0f || threshold > 1.0f) {
+			log_line(SCS_LOG_TYPE_warning, "bad layer_threshold '%s', expected travel above 0 up to 1", value.c_str());
+			return;
+		}
+		settings.layerThreshold = threshold;
+	}
+	else if (name == "speed_unit") {
+		settings.speedUnitScale = value == "mph" ? 2.2369363f : 3.6f;
+	}
+	else if (name == "trace") {
+		settings.trace = atoi(value.c_str()) != 0;
+	}
+	else if (name == "trace_trigger_us") {
+		settings.traceTriggerUs = atoi(value.c_str());
+	}
+	else if (name == "guarded_read_us") {
+		settings.guardedReadUs = atoi(value.c_str());
+	}
+	else if (name == "guarded_read_max_timeouts") {
+		settings.guardedReadMaxTimeouts = atoi(value.c_str());
+	}
+	else if (name == "stats_summary_s") {
+		settings.statsSummaryS = atoi(value.c_str());
+	}
+	else if (name == "stats_export") {
+		settings.statsExport = atoi(value.c_str()) != 0;
+	}
+	else {
+		log_line(SCS_LOG_TYPE_warning, "unknown setting '%s' in cfg file", name.c_str());
+		return;
+	}
+	if (layer > 0) {
+		log_line(SCS_LOG_TYPE_message, "imported setting %s = %s in layer %i", fullName.c_str(), value.c_str(), layer);
+	}
+	else {
+		log_line(SCS_LOG_TYPE_message, "imported setting %s = %s", fullName.c_str(), value.c_str());
+	}
+}
+
+//fill the layers and settings from the text of a cfg
+//setting lines after a 'profile <name>' line only apply when that profile is picked
+//the profile is the game id ('eut2' or 'ats') unless 'profile = <name>' picks another one
+//input setting lines after a 'layer <key>' line make a layer used while that key is held, it starts as a copy of the base layer
+void importInputs(std::istream& cfg, const std::string& gameId)
+{
+	settings = plugin_settings_t();
+	for (int l{ 0 }; l < maxLayers; ++l) {
+		layers[l] = axis_layer_t();
+	}
+	layerCount = 1;
+	activeLayer = 0;
+	inputData* tableOfInputs = layers[0].inputs;
+
+	//do for each line of cfg
+	for (int i{ 0 }; i < numOfAxes; ++i) {
+		char lineString[50];
+		cfg.getline(&lineString[0], _countof(lineString));
+		importInput(tableOfInputs[i], lineString);
+	}
+	//settings until the comment block, profile and layer sections are kept until we know which profile is picked
+	//a profile line ends the layer section, a layer line keeps the profile section so a profile can have its own layers
+	std::string profile = gameId;
+	std::string section;
+	std::string layerSection;
+	struct profile_setting_t
+	{
+		std::string profile;
+		std::string layer;
+		std::string name;
+		std::string value;
+	};
+	std::vector<profile_setting_t> profileSettings;
+	std::string settingLine;
+	while (std::getline(cfg, settingLine) && settingLine.compare(0, 2, "//") != 0) {
+		size_t equals = settingLine.find('=');
+		if (equals == std::string::npos) {
+			if (settingLine.compare(0, 8, "profile ") == 0) {
+				section = settingLine.substr(8);
+				sanitize(section, whitelist);
+				section.erase(section.find_last_not_of(' ') + 1);
+				layerSection.clear();
+			}
+			else if (settingLine.compare(0, 6, "layer ") == 0) {
+				layerSection = settingLine.substr(6);
+				sanitize(layerSection, whitelistKey);
+			}
+			continue;
+		}
+		std::string name = settingLine.substr(0, equals);
+		std::string value = settingLine.substr(equals + 1);
+		sanitize(name, whitelist);
+		sanitize(value, whitelistSetting);
+		name.erase(0, name.find_first_not_of(' '));
+		name.erase(name.find_last_not_of(' ') + 1);
+		value.erase(0, value.find_first_not_of(' '));
+		value.erase(value.find_last_not_of(' ') + 1);
+		if (name.empty()) {
+			continue;
+		}
+		if (!section.empty() || !layerSection.empty()) {
+			profileSettings.push_back({ section, layerSection, name, value });
+		}
+		else if (name == "profile") {
+			profile = value;
+		}
+		else {
+			importSetting(0, name, value);
+		}
+	}
+	int profileLines = 0;
+	for (const auto& setting : profileSettings) {
+		if (setting.profile == profile && setting.layer.empty()) {
+			importSetting(0, setting.name, setting.value);
+			++profileLines;
+		}
+	}
+	strncpy_s(settings.profile, profile.c_str(), _TRUNCATE);
+	log_line(SCS_LOG_TYPE_message, "got user values from cfg file, profile '%s' with %i settings", profile.c_str(), profileLines);
+
+	//layers in the order their first line shows up, every one starts from the finished base layer
+	std::string layerKeys[maxLayers];
+	for (const auto& setting : profileSettings) {
+		if (setting.layer.empty() || (!setting.profile.empty() && setting.profile != profile)) {
+			continue;
+		}
+		int layer = 1;
+		while (layer < layerCount && layerKeys[layer] != setting.layer) {
+			++layer;
+		}
+		if (layer == layerCount) {
+			if (layerCount == maxLayers) {
+				log_line(SCS_LOG_TYPE_warning, "more than %i layers, ignoring layer %s", maxLayers - 1, setting.layer.c_str());
+				continue;
+			}
+			axis_layer_t& added = layers[layerCount];
+			if (!importKey(setting.layer.c_str(), added.modifierCode, added.modifierNamed)) {
+				log_line(SCS_LOG_TYPE_warning, "bad layer key '%s', expected a key code or name", setting.layer.c_str());
+				continue;
+			}
+			std::copy(tableOfInputs, tableOfInputs + numOfAxes, added.inputs);
+			layerKeys[layerCount++] = setting.layer;
+		}
+		importSetting(layer, setting.name, setting.value);
+	}
+
+	//printing the layers, could remove to unclutter log
+	for (int l{ 0 }; l < layerCount; ++l) {
+		const axis_layer_t& layer = layers[l];
+		if (l > 0) {
+			const char* keyName = layer.modifierNamed ? keyNameFromCode(layer.modifierCode) : NULL;
+			log_line(SCS_LOG_TYPE_message, "imported layer %i held with %u %s", l, layer.modifierCode, keyName ? keyName : "");
+		}
+		for (int i{ 0 }; i < numOfAxes; ++i) {
+			const inputData& input = layer.inputs[i];
+			const char* keyName1 = input.keyNamed1 ? keyNameFromCode(input.keyCode1) : NULL;
+			const char* keyName2 = input.keyNamed2 ? keyNameFromCode(input.keyCode2) : NULL;
+			if (l == 0) {
+				log_line(SCS_LOG_TYPE_message, "imported name %i is %s", i, input.displayName.c_str());
+				log_line(SCS_LOG_TYPE_message, "imported key1 %i is %u %s", i, input.keyCode1, keyName1 ? keyName1 : "");
+				log_line(SCS_LOG_TYPE_message, "imported key2 %i is %u %s", i, input.keyCode2, keyName2 ? keyName2 : "");
+				log_line(SCS_LOG_TYPE_message, "imported type %i is %i", i, input.type);
+			}
+			else {
+				log_line(SCS_LOG_TYPE_message, "layer %i axis %i is %u %s, %u %s, type %i", l, i,
+					input.keyCode1, keyName1 ? keyName1 : "", input.keyCode2, keyName2 ? keyName2 : "", input.type);
+			}
+		}
+	}
+}
+
+
+//parsed cfg and the tables built from it as stored in plugins/WAfAts.cache, bump the version whenever what goes in here changes
+const unsigned int profileCacheMagic = 0x53464157;
+const unsigned int profileCacheVersion = 14;
+
+struct cached_input_t
+{
+	char displayName[50];
+	unsigned short keyCode1;
+	unsigned short keyCode2;
+	bool keyNamed1;
+	bool keyNamed2;
+	inputAxisType type;
+	speed_response_t speedResponse;
+	int ratePeriod;
+	bool rateOnChange;
+	inputDerive derive;
+	float deriveScale;
+	float slewRise;
+	float slewFall;
+	float predictFrames;
+	float predictOvershoot;
+	float deadzone;
+	char device[maxDeviceName];
+	//built by buildBoundKeys and buildSchedule
+	unsigned short hidCode1;
+	unsigned short hidCode2;
+	int keyIndex1;
+	int keyIndex2;
+	unsigned int keyMask;
+	int ratePhase;
+};
+
+//what buildBoundKeys, buildSchedule and buildFrameKernel made of the inputs
+//only good while every key translates to the physical key it had then
+struct cached_layer_t
+{
+	unsigned short modifierHid;
+	int modifierIndex;
+	unsigned int activeMask;
+	unsigned int onChangeAxes[maxBoundKeys];
+	frame_kernel_t kernel;
+};
+
+struct profile_cache_t
+{
+	unsigned int magic;
+	unsigned int version;
+	//catches layout changes without a version bump
+	unsigned int size;
+	//of the version, game id and cfg text the cache was made from
+	unsigned long long cfgHash;
+	plugin_settings_t settings;
+	int layerCount;
+	unsigned short modifierCodes[maxLayers];
+	bool modifierNamed[maxLayers];
+	cached_input_t inputs[maxLayers][numOfAxes];
+	bound_keys_t boundKeys;
+	cached_layer_t tables[maxLayers];
+};
+
+//hash of the cfg parsed by loadInputs when there is no cache for it yet, buildTables writes one
+unsigned long long profileCacheHash = 0;
+//loadInputs took the bound keys, schedule and frame kernels from the cache too
+bool profileTablesCached = false;
+
+//fnv-1a
+unsigned long long hashBytes(unsigned long long hash, const void* data, size_t size)
+{
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	for (size_t i{ 0 }; i < size; ++i) {
+		hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+	}
+	return hash;
+}
+
+void translateKeys();
+
+//the tables of the cache, when the keys still translate to the same physical keys
+bool readCachedTables(const profile_cache_t& cache)
+{
+	translateKeys();
+	for (int n{ 0 }; n < layerCount * numOfAxes; ++n) {
+		const cached_input_t& cached = cache.inputs[n / numOfAxes][n % numOfAxes];
+		const inputData& input = layers[n / numOfAxes].inputs[n % numOfAxes];
+		if (input.hidCode1 != cached.hidCode1 || input.hidCode2 != cached.hidCode2) {
+			return false;
+		}
+	}
+	for (int l{ 1 }; l < layerCount; ++l) {
+		if (layers[l].modifierHid != cache.tables[l].modifierHid) {
+			return false;
+		}
+	}
+	boundKeys = cache.boundKeys;
+	for (int l{ 0 }; l < layerCount; ++l) {
+		const cached_layer_t& cached = cache.tables[l];
+		layers[l].modifierIndex = cached.modifierIndex;
+		layers[l].activeMask = cached.activeMask;
+		std::copy(cached.onChangeAxes, cached.onChangeAxes + maxBoundKeys, layers[l].onChangeAxes);
+		layers[l].kernel = cached.kernel;
+	}
+	for (int n{ 0 }; n < layerCount * numOfAxes; ++n) {
+		const cached_input_t& cached = cache.inputs[n / numOfAxes][n % numOfAxes];
+		inputData& input = layers[n / numOfAxes].inputs[n % numOfAxes];
+		input.keyIndex1 = cached.keyIndex1;
+		input.keyIndex2 = cached.keyIndex2;
+		input.keyMask = cached.keyMask;
+		input.ratePhase = cached.ratePhase;
+	}
+	return true;
+}
+
+bool readProfileCache(unsigned long long cfgHash)
+{
+	//the whole cache is one block, used straight from the mapping
+	mapped_file_t mapped;
+	if (!mapFile("plugins/WAfAts.cache", mapped) || mapped.size != sizeof(profile_cache_t)) {
+		unmapFile(mapped);
+		return false;
+	}
+	const profile_cache_t& cache = *reinterpret_cast<const profile_cache_t*>(mapped.data);
+	if (cache.magic != profileCacheMagic || cache.version != profileCacheVersion || cache.size != sizeof(cache) || cache.cfgHash != cfgHash
+		|| cache.layerCount < 1 || cache.layerCount > maxLayers) {
+		unmapFile(mapped);
+		return false;
+	}
+	settings = cache.settings;
+	layerCount = cache.layerCount;
+	activeLayer = 0;
+	for (int l{ 0 }; l < maxLayers; ++l) {
+		layers[l] = axis_layer_t();
+		layers[l].modifierCode = cache.modifierCodes[l];
+		layers[l].modifierNamed = cache.modifierNamed[l];
+	}
+	//every input of every layer in one run
+	for (int n{ 0 }; n < layerCount * numOfAxes; ++n) {
+		const cached_input_t& cached = cache.inputs[n / numOfAxes][n % numOfAxes];
+		inputData& input = layers[n / numOfAxes].inputs[n % numOfAxes];
+		input.displayName.assign(cached.displayName, strnlen(cached.displayName, sizeof(cached.displayName)));
+		input.keyCode1 = cached.keyCode1;
+		input.keyCode2 = cached.keyCode2;
+		input.keyNamed1 = cached.keyNamed1;
+		input.keyNamed2 = cached.keyNamed2;
+		input.type = cached.type;
+		input.speedResponse = cached.speedResponse;
+		input.ratePeriod = cached.ratePeriod;
+		input.rateOnChange = cached.rateOnChange;
+		input.derive = cached.derive;
+		input.deriveScale = cached.deriveScale;
+		input.slewRise = cached.slewRise;
+		input.slewFall = cached.slewFall;
+		input.predictFrames = cached.predictFrames;
+		input.predictOvershoot = cached.predictOvershoot;
+		input.deadzone = cached.deadzone;
+		input.device.assign(cached.device, strnlen(cached.device, sizeof(cached.device)));
+	}
+	profileTablesCached = readCachedTables(cache);
+	unmapFile(mapped);
+	return true;
+}
+
+void writeProfileCache(unsigned long long cfgHash)
+{
+	static profile_cache_t cache;
+	cache = profile_cache_t();
+	cache.magic = profileCacheMagic;
+	cache.version = profileCacheVersion;
+	cache.size = sizeof(cache);
+	cache.cfgHash = cfgHash;
+	cache.settings = settings;
+	cache.layerCount = layerCount;
+	for (int l{ 0 }; l < maxLayers; ++l) {
+		cache.modifierCodes[l] = layers[l].modifierCode;
+		cache.modifierNamed[l] = layers[l].modifierNamed;
+	}
+	for (int n{ 0 }; n < layerCount * numOfAxes; ++n) {
+		const inputData& input = layers[n / numOfAxes].inputs[n % numOfAxes];
+		cached_input_t& cached = cache.inputs[n / numOfAxes][n % numOfAxes];
+		strncpy_s(cached.displayName, input.displayName.c_str(), _TRUNCATE);
+		cached.keyCode1 = input.keyCode1;
+		cached.keyCode2 = input.keyCode2;
+		cached.keyNamed1 = input.keyNamed1;
+		cached.keyNamed2 = input.keyNamed2;
+		cached.type = input.type;
+		cached.speedResponse = input.speedResponse;
+		cached.ratePeriod = input.ratePeriod;
+		cached.rateOnChange = input.rateOnChange;
+		cached.derive = input.derive;
+		cached.deriveScale = input.deriveScale;
+		cached.slewRise = input.slewRise;
+		cached.slewFall = input.slewFall;
+		cached.predictFrames = input.predictFrames;
+		cached.predictOvershoot = input.predictOvershoot;
+		cached.deadzone = input.deadzone;
+		strncpy_s(cached.device, input.device.c_str(), _TRUNCATE);
+		cached.hidCode1 = input.hidCode1;
+		cached.hidCode2 = input.hidCode2;
+		cached.keyIndex1 = input.keyIndex1;
+		cached.keyIndex2 = input.keyIndex2;
+		cached.keyMask = input.keyMask;
+		cached.ratePhase = input.ratePhase;
+	}
+	cache.boundKeys = boundKeys;
+	for (int l{ 0 }; l < layerCount; ++l) {
+		cached_layer_t& cached = cache.tables[l];
+		cached.modifierHid = layers[l].modifierHid;
+		cached.modifierIndex = layers[l].modifierIndex;
+		cached.activeMask = layers[l].activeMask;
+		std::copy(layers[l].onChangeAxes, layers[l].onChangeAxes + maxBoundKeys, cached.onChangeAxes);
+		cached.kernel = layers[l].kernel;
+	}
+	//through a temporary so a crash mid write leaves the last cache, not a torn one
+	if (!heapFreeWrite("plugins/WAfAts.cache", "plugins/WAfAts.cache.tmp", &cache, sizeof(cache))) {
+		log_line(SCS_LOG_TYPE_warning, "failure writing plugins/WAfAts.cache, the cfg will be parsed again next time");
+	}
+}
+
+//load the profile for this game, from the cache when the cfg hasn't changed since it was parsed
+void loadInputs(const std::string& gameId)
+{
+	profileCacheHash = 0;
+	profileTablesCached = false;
+	std::ifstream file("plugins/WAfAts.cfg");
+	if (!file.good()) {
+		log_line(SCS_LOG_TYPE_warning, "failure reading cfg file, using default keys (WASD)");
+		settings = plugin_settings_t();
+		for (int l{ 0 }; l < maxLayers; ++l) {
+			layers[l] = axis_layer_t();
+		}
+		layerCount = 1;
+		activeLayer = 0;
+		inputData* tableOfInputs = layers[0].inputs;
+		tableOfInputs[1].displayName = "Analog key W";
+		tableOfInputs[1].keyCode1 = 26;
+		tableOfInputs[1].type = single;
+		tableOfInputs[2].displayName = "Analog key S";
+		tableOfInputs[2].keyCode1 = 22;
+		tableOfInputs[2].type = single;
+		tableOfInputs[3].displayName = "Analog key AD";
+		tableOfInputs[3].keyCode1 = 4;
+		tableOfInputs[3].keyCode2 = 7;
+		tableOfInputs[3].type = dual;
+		return;
+	}
+	//nothing after the comment block changes the result, so it is neither hashed nor parsed
+	std::string text;
+	std::string line;
+	while (std::getline(file, line) && line.compare(0, 2, "//") != 0) {
+		text += line;
+		text += '\n';
+	}
+	file.close();
+
+	unsigned long long cfgHash = 0xcbf29ce484222325ull;
+	cfgHash = hashBytes(cfgHash, &profileCacheVersion, sizeof(profileCacheVersion));
+	cfgHash = hashBytes(cfgHash, gameId.c_str(), gameId.size() + 1);
+	cfgHash = hashBytes(cfgHash, text.data(), text.size());
+	if (readProfileCache(cfgHash)) {
+		log_line(SCS_LOG_TYPE_message, "cfg unchanged, loaded profile for '%s' from plugins/WAfAts.cache", gameId.c_str());
+		return;
+	}
+	std::istringstream cfg(text);
+	importInputs(cfg, gameId);
+	profileCacheHash = cfgHash;
+}
+
+
+int countBits(unsigned int bits)
+{
+	int count = 0;
+	for (; bits != 0; bits &= bits - 1) {
+		++count;
+	}
+	return count;
+}
+
+//keyboard layout the bound keys were translated with, only used with keycode_mode = virtualkey_translate
+void* boundLayout = NULL;
+
+//physical hid code of a cfg key, 0 if it has none
+//names are hid codes in every mode except virtualkey_translate, where they mean the key that types that letter
+unsigned short physicalKey(unsigned short keyCode, bool named)
+{
+	switch (settings.keycodeMode) {
+	case WootingAnalog_KeycodeType_ScanCode1:
+		return named ? keyCode : (unsigned short)hidFromScanCode1(keyCode);
+	case WootingAnalog_KeycodeType_VirtualKey:
+		return named ? keyCode : (unsigned short)hidFromVirtualKey(keyCode);
+	case WootingAnalog_KeycodeType_VirtualKeyTranslate:
+	{
+		int virtualKey = named ? virtualKeyFromHid(keyCode) : keyCode;
+#ifdef _WIN32
+		//4 = MAPVK_VK_TO_VSC_EX, gives extended keys as 0xe0xx like the scan code table
+		return (unsigned short)hidFromScanCode1(MapVirtualKeyExA(virtualKey, 4, (HKL)boundLayout));
+#else
+		return (unsigned short)hidFromVirtualKey(virtualKey);
+#endif
+	}
+	default:
+		return keyCode;
+	}
+}
+
+//translate every key to its physical key for this layout, reads stay in hid mode so the sdk never translates per read
+void translateKeys()
+{
+#ifdef _WIN32
+	if (settings.keycodeMode == WootingAnalog_KeycodeType_VirtualKeyTranslate) {
+		boundLayout = GetKeyboardLayout(0);
+		log_line(SCS_LOG_TYPE_message, "translating keys with keyboard layout %p", boundLayout);
+	}
+#endif
+	for (int l{ 0 }; l < layerCount; ++l) {
+		axis_layer_t& layer = layers[l];
+		if (l > 0) {
+			layer.modifierHid = physicalKey(layer.modifierCode, layer.modifierNamed);
+			if (layer.modifierHid == 0) {
+				log_line(SCS_LOG_TYPE_warning, "modifier key %u of layer %i has no physical key in this keycode_mode", layer.modifierCode, l);
+			}
+		}
+		for (int i{ 0 }; i < numOfAxes; ++i) {
+			inputData& input = layer.inputs[i];
+			input.hidCode1 = physicalKey(input.keyCode1, input.keyNamed1);
+			input.hidCode2 = physicalKey(input.keyCode2, input.keyNamed2);
+			if ((input.type == single || input.type == dual) && input.hidCode1 == 0 && input.keyCode1 != 0) {
+				log_line(SCS_LOG_TYPE_warning, "key1 %u of %s has no physical key in this keycode_mode", input.keyCode1, input.displayName.c_str());
+			}
+			if (input.type == dual && input.hidCode2 == 0 && input.keyCode2 != 0) {
+				log_line(SCS_LOG_TYPE_warning, "key2 %u of %s has no physical key in this keycode_mode", input.keyCode2, input.displayName.c_str());
+			}
+		}
+	}
+}
+
+//fill boundKeys from every layer and point every axis and modifier at its keys
+//false if the layers use more than maxBoundKeys keys, nothing but the physical keys of the inputs is changed then
+bool buildBoundKeys()
+{
+	translateKeys();
+	unsigned short codes[maxLayers * (maxBoundKeys + 1)];
+	int count = 0;
+	for (int l{ 0 }; l < layerCount; ++l) {
+		const axis_layer_t& layer = layers[l];
+		if (l > 0) {
+			codes[count++] = layer.modifierHid;
+		}
+		for (int i{ 0 }; i < numOfAxes; ++i) {
+			if (layer.inputs[i].type == single || layer.inputs[i].type == dual) {
+				codes[count++] = layer.inputs[i].hidCode1;
+			}
+			if (layer.inputs[i].type == dual) {
+				codes[count++] = layer.inputs[i].hidCode2;
+			}
+		}
+	}
+	std::sort(codes, codes + count);
+	count = int(std::unique(codes, codes + count) - codes);
+	if (count > maxBoundKeys) {
+		log_line(SCS_LOG_TYPE_error, "the %i layers use %i different keys, only %i fit, bind fewer keys or remove a layer", layerCount, count, maxBoundKeys);
+		return false;
+	}
+	std::copy(codes, codes + count, boundKeys.codes);
+	boundKeys.count = count;
+	boundKeys.modifierMask = 0;
+	activeLayer = activeLayer < layerCount ? activeLayer : 0;
+
+	for (int l{ 0 }; l < layerCount; ++l) {
+		axis_layer_t& layer = layers[l];
+		layer.activeMask = 0;
+		for (int i{ 0 }; i < numOfAxes; ++i) {
+			inputData& input = layer.inputs[i];
+			if (input.type != disabled) {
+				layer.activeMask |= 1u << i;
+			}
+			input.keyIndex1 = int(std::lower_bound(boundKeys.codes, boundKeys.codes + boundKeys.count, input.hidCode1) - boundKeys.codes);
+			input.keyIndex2 = int(std::lower_bound(boundKeys.codes, boundKeys.codes + boundKeys.count, input.hidCode2) - boundKeys.codes);
+		}
+		if (l > 0) {
+			layer.modifierIndex = int(std::lower_bound(boundKeys.codes, boundKeys.codes + boundKeys.count, layer.modifierHid) - boundKeys.codes);
+			boundKeys.modifierMask |= 1u << layer.modifierIndex;
+		}
+	}
+	log_line(SCS_LOG_TYPE_message, "%i unique keys bound in %i layers", boundKeys.count, layerCount);
+	return true;
+}
+
+//frames the phases of slower axes are spread over, a multiple of every period up to 6
+const int scheduleHorizon = 240;
+
+//give every axis of a layer its keys and every slower axis the phase that adds the least to the busiest frame
+//returns the keys the layer reads every frame
+unsigned int scheduleLayer(axis_layer_t& layer, int l)
+{
+	for (int k{ 0 }; k < boundKeys.count; ++k) {
+		layer.onChangeAxes[k] = 0;
+	}
+	unsigned int everyFrameKeys = 0;
+	for (int i{ 0 }; i < numOfAxes; ++i) {
+		inputData& input = layer.inputs[i];
+		input.keyMask = 0;
+		input.ratePhase = 0;
+		//a derivative or a prediction needs a sample every frame
+		if ((input.derive != derive_none || input.predictFrames > 0.0f) && (input.ratePeriod != 1 || input.rateOnChange)) {
+			log_line(SCS_LOG_TYPE_warning, "axis %i of layer %i is derived or predicted, it is read every frame regardless of its rate", i, l);
+			input.ratePeriod = 1;
+			input.rateOnChange = false;
+		}
+		if (input.type == single || input.type == dual) {
+			input.keyMask |= 1u << input.keyIndex1;
+		}
+		if (input.type == dual) {
+			input.keyMask |= 1u << input.keyIndex2;
+		}
+		if (input.rateOnChange) {
+			for (int k{ 0 }; k < boundKeys.count; ++k) {
+				if (input.keyMask & (1u << k)) {
+					layer.onChangeAxes[k] |= 1u << i;
+				}
+			}
+		}
+		else if (input.ratePeriod == 1) {
+			everyFrameKeys |= input.keyMask;
+		}
+	}
+
+	//fastest tiers first, they have the fewest phases to pick from
+	int load[scheduleHorizon] = {};
+	for (int period{ 2 }; period <= maxRatePeriod; ++period) {
+		for (int i{ 0 }; i < numOfAxes; ++i) {
+			inputData& input = layer.inputs[i];
+			if (input.type == disabled || input.rateOnChange || input.ratePeriod != period) {
+				continue;
+			}
+			//keys already read every frame cost nothing extra
+			int cost = countBits(input.keyMask & ~(everyFrameKeys | boundKeys.modifierMask));
+			int bestPeak = -1;
+			for (int phase{ 0 }; phase < period; ++phase) {
+				int peak = 0;
+				for (int frame{ phase }; frame < scheduleHorizon; frame += period) {
+					peak = load[frame] > peak ? load[frame] : peak;
+				}
+				if (bestPeak < 0 || peak < bestPeak) {
+					bestPeak = peak;
+					input.ratePhase = phase;
+				}
+			}
+			for (int frame{ input.ratePhase }; frame < scheduleHorizon; frame += period) {
+				load[frame] += cost;
+			}
+			log_line(SCS_LOG_TYPE_message, "axis %i of layer %i read every %i frames at phase %i", i, l, period, input.ratePhase);
+		}
+	}
+	return everyFrameKeys;
+}
+
+//schedule every layer, the keys the layer switch depends on are read first, then the keys of every frame axes of any layer
+void buildSchedule()
+{
+	unsigned int everyFrameKeys = boundKeys.modifierMask;
+	for (int l{ 0 }; l < layerCount; ++l) {
+		everyFrameKeys |= scheduleLayer(layers[l], l);
+	}
+	int readCount = 0;
+	for (int k{ 0 }; k < boundKeys.count; ++k) {
+		if (boundKeys.modifierMask & (1u << k)) {
+			boundKeys.readOrder[readCount++] = k;
+		}
+	}
+	for (int k{ 0 }; k < boundKeys.count; ++k) {
+		if ((everyFrameKeys & ~boundKeys.modifierMask) & (1u << k)) {
+			boundKeys.readOrder[readCount++] = k;
+		}
+	}
+	for (int k{ 0 }; k < boundKeys.count; ++k) {
+		if (!(everyFrameKeys & (1u << k))) {
+			boundKeys.readOrder[readCount++] = k;
+		}
+	}
+}
+
+
+//group the axes into registered devices in the order of their first axis
+void buildRegisteredDevices()
+{
+	registeredDeviceCount = 0;
+	for (int i{ 0 }; i < numOfAxes; ++i) {
+		const std::string& device = layers[0].inputs[i].device;
+		std::string name = device.empty() ? "wootdevice" : "woot_" + device;
+		int d = 0;
+		while (d < registeredDeviceCount && registeredDevices[d].name != name) {
+			++d;
+		}
+		if (d == registeredDeviceCount) {
+			registered_device_t& added = registeredDevices[registeredDeviceCount++];
+			added = registered_device_t();
+			added.name = name;
+			added.displayName = device.empty() ? "Wooting Analog sdk Device" : "Wooting Analog sdk Device " + device;
+			//the first frame takes a snapshot of its own
+			added.snapshot = AnalogKeyboard.snapshot;
+		}
+		registered_device_t& registered = registeredDevices[d];
+		registered.axes |= 1u << i;
+		registered.inputIndex[i] = registered.inputCount++;
+	}
+	if (registeredDeviceCount > 1) {
+		for (int d{ 0 }; d < registeredDeviceCount; ++d) {
+			log_line(SCS_LOG_TYPE_message, "device %s has %i inputs", registeredDevices[d].name.c_str(), registeredDevices[d].inputCount);
+		}
+	}
+}
+
+
+//set while the sdk reports the keyboard missing, to count reconnects
+bool keyboardMissing = false;
+
+//pass a read analog value through or handle error
+float checkKeyValue(float keyValue)
+{
+	if (keyValue >= 0) {
+		if (keyboardMissing) {
+			keyboardMissing = false;
+			statsAdd(stat_reconnects);
+		}
+		return keyValue;
+	}
+	else {
+		statsSdkError(int(keyValue));
+		if (int(keyValue) == WootingAnalogResult_NoDevices || int(keyValue) == WootingAnalogResult_DeviceDisconnected) {
+			keyboardMissing = true;
+		}
+		log_line(SCS_LOG_TYPE_error, "failure reading analog key value, error code = %f", keyValue);
+		return 0.0;
+	}
+}
+
+
+//max pressed keys taken from one wooting_analog_read_full_buffer call
+const int fullBufferSize = 32;
+
+//the sdk reads of one frame, done on the game thread or by the guarded reader
+struct key_reads_t
+{
+	//bits of boundKeys to read one by one
+	unsigned int keyMask = 0;
+	//also read all pressed keys at once for the axes that only update on change
+	bool fullBuffer = false;
+	float values[maxBoundKeys] = {};
+	//number of pressed keys or a WootingAnalogResult error
+	int fullBufferCount = 0;
+	unsigned short fullBufferCodes[fullBufferSize] = {};
+	float fullBufferValues[fullBufferSize] = {};
+};
+
+//raw sdk reads without any logging so it can run on any thread, keys of every frame axes go first
+void readKeys(key_reads_t& reads)
+{
+	TRACE_SPAN("sdk reads");
+	for (int k{ 0 }; k < boundKeys.count; ++k) {
+		int i = boundKeys.readOrder[k];
+		if (reads.keyMask & (1u << i)) {
+			reads.values[i] = wooting_analog_read_analog(boundKeys.codes[i]);
+		}
+	}
+	if (reads.fullBuffer) {
+		reads.fullBufferCount = wooting_analog_read_full_buffer(reads.fullBufferCodes, reads.fullBufferValues, fullBufferSize);
+	}
+}
+
+//take the reads of a frame into boundKeys or handle errors
+//returns the on change axes whose keys moved
+unsigned int applyKeyReads(const key_reads_t& reads)
+{
+	for (int i{ 0 }; i < boundKeys.count; ++i) {
+		if (reads.keyMask & (1u << i)) {
+			float value = checkKeyValue(reads.values[i]);
+			boundKeys.values[i] = calibrationEnabled ? calibrationApply(boundKeys.codes[i], value) : value;
+		}
+	}
+	unsigned int changedAxes = 0;
+	if (reads.fullBuffer) {
+		if (reads.fullBufferCount < 0) {
+			checkKeyValue(float(reads.fullBufferCount));
+			return 0;
+		}
+		//released keys show up once with 0, keys that stay released are left out
+		for (int j{ 0 }; j < reads.fullBufferCount && j < fullBufferSize; ++j) {
+			const unsigned short* key = std::lower_bound(boundKeys.codes, boundKeys.codes + boundKeys.count, reads.fullBufferCodes[j]);
+			int i = int(key - boundKeys.codes);
+			if (i >= boundKeys.count || *key != reads.fullBufferCodes[j] || (reads.keyMask & (1u << i))) {
+				continue;
+			}
+			float value = calibrationEnabled ? calibrationApply(boundKeys.codes[i], reads.fullBufferValues[j]) : reads.fullBufferValues[j];
+			if (boundKeys.values[i] != value) {
+				boundKeys.values[i] = value;
+				changedAxes |= layers[activeLayer].onChangeAxes[i];
+			}
+		}
+	}
+	return changedAxes;
+}
+
+
+//does the sdk reads of a frame on a worker thread so a hung sdk call can't freeze the game
+//only the main thread logs, the game doesn't allow calls back into it from other threads
+struct guarded_reader_t
+{
+	std::thread worker;
+	std::mutex mutex;
+	std::condition_variable wake;
+	bool stop = false;
+	//frame numbers asked for by the main thread and finished by the worker, equal when the worker is idle
+	std::atomic<unsigned int> requested{ 0 };
+	std::atomic<unsigned int> completed{ 0 };
+	//only touched by the side that owns it, handed over with the requested/completed stores
+	key_reads_t reads;
+	int timeoutsInARow = 0;
+	bool degraded = false;
+};
+
+//a worker stuck inside the sdk keeps its reader alive, so this is only deleted after a join
+guarded_reader_t* guardedReader = NULL;
+
+void guardedReaderLoop(guarded_reader_t* reader)
+{
+	unsigned int done = reader->completed.load(std::memory_order_relaxed);
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> lock(reader->mutex);
+			reader->wake.wait(lock, [&] { return reader->stop || reader->requested.load(std::memory_order_relaxed) != done; });
+			if (reader->stop) {
+				return;
+			}
+		}
+		TRACE_SPAN("guarded read");
+		unsigned int request = reader->requested.load(std::memory_order_acquire);
+		readKeys(reader->reads);
+		done = request;
+		reader->completed.store(request, std::memory_order_release);
+	}
+}
+
+void startGuardedReader()
+{
+	guardedReader = new guarded_reader_t;
+	guardedReader->worker = std::thread(guardedReaderLoop, guardedReader);
+	log_line(SCS_LOG_TYPE_message, "guarded sdk reads enabled, budget = %i us", settings.guardedReadUs);
+	if ((settings.sampler.affinity != 0 || settings.sampler.priority != sampler_priority_normal) && !samplerApply(settings.sampler, &guardedReader->worker)) {
+		log_line(SCS_LOG_TYPE_warning, "unable to set affinity 0x%llx and priority %i of the sdk worker", settings.sampler.affinity, int(settings.sampler.priority));
+	}
+}
+
+void stopGuardedReader()
+{
+	if (guardedReader == NULL) {
+		return;
+	}
+	bool idle = guardedReader->completed.load(std::memory_order_acquire) == guardedReader->requested.load(std::memory_order_relaxed);
+	{
+		std::lock_guard<std::mutex> lock(guardedReader->mutex);
+		guardedReader->stop = true;
+	}
+	guardedReader->wake.notify_one();
+	if (idle) {
+		guardedReader->worker.join();
+		delete guardedReader;
+	}
+	else {
+		//joining would hang the game the same way the read would have
+		log_line(SCS_LOG_TYPE_error, "sdk read still hung on shutdown, abandoning worker");
+		guardedReader->worker.detach();
+	}
+	guardedReader = NULL;
+}
+
+//ask the worker for a frame and wait for it at most the budget
+//returns false if the worker didn't make it, reads is filled in when it did
+bool guardedRead(guarded_reader_t& reader, key_reads_t& reads)
+{
+	unsigned int request = reader.requested.load(std::memory_order_relaxed);
+	//still busy with an earlier frame
+	if (reader.completed.load(std::memory_order_acquire) != request) {
+		return false;
+	}
+	reader.reads.keyMask = reads.keyMask;
+	reader.reads.fullBuffer = reads.fullBuffer;
+	{
+		std::lock_guard<std::mutex> lock(reader.mutex);
+		reader.requested.store(++request, std::memory_order_release);
+	}
+	reader.wake.notify_one();
+	//once degraded the request only probes whether the sdk answers again, it is not waited for
+	if (reader.degraded) {
+		return false;
+	}
+
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(settings.guardedReadUs);
+	while (reader.completed.load(std::memory_order_acquire) != request) {
+		if (std::chrono::steady_clock::now() >= deadline) {
+			return false;
+		}
+		std::this_thread::yield();
+	}
+	reads = reader.reads;
+	return true;
+}
+
+//guarded read of a frame, holding the last good values on a timeout
+bool sampleBoundKeysGuarded(guarded_reader_t& reader, key_reads_t& reads)
+{
+	//the probe sent while degraded came back, the sdk is responsive again
+	if (reader.degraded && reader.completed.load(std::memory_order_acquire) == reader.requested.load(std::memory_order_relaxed)) {
+		reader.degraded = false;
+		reader.timeoutsInARow = 0;
+		log_line(SCS_LOG_TYPE_message, "sdk is responding again, resuming reads");
+	}
+
+	if (guardedRead(reader, reads)) {
+		reader.timeoutsInARow = 0;
+		return true;
+	}
+	if (reader.degraded) {
+		return false;
+	}
+	statsAdd(stat_sdk_timeouts);
+	if (++reader.timeoutsInARow >= settings.guardedReadMaxTimeouts) {
+		reader.degraded = true;
+		log_line(SCS_LOG_TYPE_error, "sdk missed the read budget %i times in a row, holding last values", reader.timeoutsInARow);
+	}
+	return false;
+}
+
+
+//2 inputs 0 to 1, 1 output -1 to 1
+//A and D need to be the same axis with D being positive and A negative
+//set to output the greater value if both are partially pressed or no value if equally pressed
+float calculateSharedAxis(float left, float right)
+{
+	if (left == right) { return 0.0; }
+	else if (left > right) { return -left; }
+	else { return right; }
+}
+
+
+frame_kernel_fn runFrameKernel = frameKernelScalar;
+
+//load the key indices, derive modes and speed response tables of every axis of every layer into its kernel lanes, lane i is axis i
+void buildFrameKernel()
+{
+	for (int l{ 0 }; l < layerCount; ++l) {
+		frame_kernel_t& kernel = layers[l].kernel;
+		kernel = frame_kernel_t();
+		for (int i{ 0 }; i < kernelLanes; ++i) {
+			kernel.leftKeys[i] = maxBoundKeys;
+			kernel.rightKeys[i] = maxBoundKeys;
+		}
+		for (int i{ 0 }; i < numOfAxes; ++i) {
+			const inputData& input = layers[l].inputs[i];
+			if (input.type == single) {
+				kernel.rightKeys[i] = input.keyIndex1;
+			}
+			else if (input.type == dual) {
+				kernel.leftKeys[i] = input.keyIndex1;
+				kernel.rightKeys[i] = input.keyIndex2;
+			}
+			kernel.derivedLanes[i] = input.derive != derive_none || input.predictFrames > 0.0f ? -1 : 0;
+			kernel.deadzones[i] = input.deadzone;
+			kernel.deadzoneScales[i] = 1.0f / (1.0f - input.deadzone);
+			kernel.shapedLanes[i] = input.speedResponse.bands > 0 ? -1 : 0;
+			for (int b{ 0 }; b < input.speedResponse.bands; ++b) {
+				std::copy(input.speedResponse.tables[b], input.speedResponse.tables[b] + responseTableSize, kernel.tables + (i * maxSpeedBands + b) * responseTableSize);
+			}
+			kernel.lowTables[i] = i * maxSpeedBands * responseTableSize;
+			kernel.highTables[i] = kernel.lowTables[i];
+		}
+	}
+}
+
+//bound keys, schedule and frame kernels of the loaded profile, taken from the cache by loadInputs when it could
+//a profile that was parsed gets its cache written once they are built, false if its keys don't fit
+bool buildTables()
+{
+	if (profileTablesCached) {
+		log_line(SCS_LOG_TYPE_message, "%i unique keys bound in %i layers, tables from plugins/WAfAts.cache", boundKeys.count, layerCount);
+		return true;
+	}
+	if (!buildBoundKeys()) {
+		return false;
+	}
+	buildSchedule();
+	buildFrameKernel();
+	if (profileCacheHash != 0) {
+		writeProfileCache(profileCacheHash);
+		profileCacheHash = 0;
+	}
+	return true;
+}
+
+//pick the fastest kernel the cpu and the cfg allow, WAfAtsAnalyzer --check is what makes sure they all match the scalar one
+void selectFrameKernel()
+{
+	frameKernelLevel level = detectFrameKernel();
+	level = level < settings.frameKernel ? level : settings.frameKernel;
+	runFrameKernel = frameKernelOf(level);
+	if (runFrameKernel == NULL) {
+		level = kernel_scalar;
+		runFrameKernel = frameKernelScalar;
+	}
+	log_line(SCS_LOG_TYPE_message, "frame kernel = %s", frameKernelName(level));
+}
+
+
+//key travel of an axis, -1 to 1 for dual axes
+float axisPosition(const inputData& input)
+{
+	if (input.type == single) {
+		return boundKeys.values[input.keyIndex1];
+	}
+	else if (input.type == dual) {
+		return calculateSharedAxis(boundKeys.values[input.keyIndex1], boundKeys.values[input.keyIndex2]);
+	}
+	return 0.0f;
+}
+
+
+//list the derived axes of every layer
+void buildDerivedAxes()
+{
+	for (int l{ 0 }; l < layerCount; ++l) {
+		derived_axes_t& derived = layers[l].derived;
+		derived = derived_axes_t();
+		for (int i{ 0 }; i < numOfAxes; ++i) {
+			if (layers[l].inputs[i].derive != derive_none && layers[l].inputs[i].type != disabled) {
+				derived.axes[derived.count++] = i;
+			}
+		}
+	}
+}
+
+//push this frame's positions and fit the window of every derived axis
+//velocity is the slope of a straight line fit, acceleration is 2c of a fit of x = a + b*t + c*t^2
+//no branches in the fit, a ring refilled after a resync just gives 0
+void updateDerivedAxes(const device_data_t& device, bool resync)
+{
+	const inputData* inputs = layers[activeLayer].inputs;
+	derived_axes_t& derived = layers[activeLayer].derived;
+	if (derived.count == 0) {
+		return;
+	}
+	TRACE_SPAN("updateDerivedAxes");
+	int head = (derived.head + 1) % derivativeWindow;
+	derived.head = head;
+	//after a resync the old samples are from before a pause, start over with a flat ring
+	int first = resync ? 0 : head;
+	int last = resync ? derivativeWindow : head + 1;
+	for (int j{ first }; j < last; ++j) {
+		derived.times[j] = device.sampleTime;
+	}
+	for (int d{ 0 }; d < derived.count; ++d) {
+		float position = axisPosition(inputs[derived.axes[d]]);
+		for (int j{ first }; j < last; ++j) {
+			derived.values[d][j] = position;
+		}
+	}
+
+	//times in seconds around their mean, the same for every axis
+	float t[derivativeWindow];
+	float mean = 0.0f;
+	for (int j{ 0 }; j < derivativeWindow; ++j) {
+		t[j] = float(derived.times[j] - derived.times[head]) * 1e-9f;
+		mean += t[j];
+	}
+	mean /= derivativeWindow;
+	float s2 = 0.0f, s3 = 0.0f, s4 = 0.0f;
+	for (int j{ 0 }; j < derivativeWindow; ++j) {
+		t[j] -= mean;
+		float t2 = t[j] * t[j];
+		s2 += t2;
+		s3 += t2 * t[j];
+		s4 += t2 * t2;
+	}
+	//quadratic normal equations with sum(t) = 0, solved for c by cramer's rule
+	float n = float(derivativeWindow);
+	float det = n * (s2 * s4 - s3 * s3) - s2 * s2 * s2 + 1e-30f;
+
+	for (int d{ 0 }; d < derived.count; ++d) {
+		//relative to the newest sample so a key at rest gives exactly 0
+		float newest = derived.values[d][head];
+		float sy = 0.0f, sty = 0.0f, stty = 0.0f;
+		for (int j{ 0 }; j < derivativeWindow; ++j) {
+			float y = derived.values[d][j] - newest;
+			sy += y;
+			sty += t[j] * y;
+			stty += t[j] * t[j] * y;
+		}
+		float slope = sty / (s2 + 1e-30f);
+		float c = (n * (s2 * stty - s3 * sty) - s2 * s2 * sy) / det;
+		const inputData& input = inputs[derived.axes[d]];
+		float rate = input.derive == derive_velocity ? slope : 2.0f * c;
+		float output = rate * input.deriveScale;
+		derived.outputs[derived.axes[d]] = std::fmax(-1.0f, std::fmin(1.0f, output));
+	}
+}
+
+
+//list the predicted axes of every layer
+void buildPredictedAxes()
+{
+	for (int l{ 0 }; l < layerCount; ++l) {
+		predicted_axes_t& predicted = layers[l].predicted;
+		predicted = predicted_axes_t();
+		for (int i{ 0 }; i < numOfAxes; ++i) {
+			const inputData& input = layers[l].inputs[i];
+			if (input.predictFrames <= 0.0f || input.type == disabled) {
+				continue;
+			}
+			if (input.derive != derive_none) {
+				log_line(SCS_LOG_TYPE_warning, "axis %i of layer %i is derived, predict is ignored", i, l);
+				continue;
+			}
+			predicted.axes[predicted.count++] = i;
+		}
+	}
+}
+
+
+#ifdef _WIN32
+//translate the bound keys again when the user switches keyboard layout, looked at every 60 frames
+void checkKeyboardLayout(device_data_t& device)
+{
+	if (settings.keycodeMode != WootingAnalog_KeycodeType_VirtualKeyTranslate || device.frameNumber % 60 != 0 || GetKeyboardLayout(0) == boundLayout) {
+		return;
+	}
+	//the guarded reader uses boundKeys, try again later if it is still busy
+	if (guardedReader != NULL && guardedReader->completed.load(std::memory_order_acquire) != guardedReader->requested.load(std::memory_order_relaxed)) {
+		return;
+	}
+	log_line(SCS_LOG_TYPE_message, "keyboard layout changed");
+	//the keys of the last layout stay bound, this layout isn't tried again until the next change
+	if (!buildBoundKeys()) {
+		log_line(SCS_LOG_TYPE_error, "the keys don't fit with keyboard layout %p, still reading the keys of the last layout", boundLayout);
+		return;
+	}
+	buildSchedule();
+	buildDerivedAxes();
+	buildPredictedAxes();
+	buildFrameKernel();
+	for (int i{ 0 }; i < boundKeys.count; ++i) {
+		boundKeys.values[i] = 0.0f;
+	}
+	//the recorded values are of other keys from here on
+	if (recordingEnabled) {
+		recordingSegment(device.frameStart, boundKeys.codes, boundKeys.count);
+	}
+	device.resync = true;
+}
+#endif
+
+
+//learn the frame time from the spacing of frame starts, the first frame after a pause doesn't count
+void updateFrameEstimate(device_data_t& device)
+{
+	long long interval = device.frameStart - device.lastFrameStart;
+	if (device.lastFrameStart > 0 && !device.resync) {
+		device.frameEstimate = device.frameEstimate == 0 ? interval : device.frameEstimate + (interval - device.frameEstimate) / 8;
+	}
+	device.lastFrameStart = device.frameStart;
+}
+
+//push this frame's positions, score the predictions whose target time has passed and extrapolate every predicted axis
+//to the sample time plus its horizon along the slope of a straight line fit
+void updatePredictedAxes(const device_data_t& device, bool resync)
+{
+	const inputData* inputs = layers[activeLayer].inputs;
+	predicted_axes_t& predicted = layers[activeLayer].predicted;
+	if (predicted.count == 0) {
+		return;
+	}
+	TRACE_SPAN("updatePredictedAxes");
+	int previous = predicted.head;
+	int head = (previous + 1) % predictWindow;
+	predicted.head = head;
+	//after a resync the old samples are from before a pause, start over with a flat ring
+	int first = resync ? 0 : head;
+	int last = resync ? predictWindow : head + 1;
+	for (int j{ first }; j < last; ++j) {
+		predicted.times[j] = device.sampleTime;
+	}
+	for (int d{ 0 }; d < predicted.count; ++d) {
+		float position = axisPosition(inputs[predicted.axes[d]]);
+		for (int j{ first }; j < last; ++j) {
+			predicted.values[d][j] = position;
+		}
+		if (resync) {
+			predicted.pendingCount[d] = 0;
+		}
+	}
+
+	//the axis between the last two samples is taken as a straight line, errors in 1/10000 of travel
+	long long start = predicted.times[previous];
+	long long span = device.sampleTime - start;
+	for (int d{ 0 }; d < predicted.count && span > 0; ++d) {
+		float from = predicted.values[d][previous];
+		float to = predicted.values[d][head];
+		int done = 0;
+		while (done < predicted.pendingCount[d] && predicted.pending[d][done].target <= device.sampleTime) {
+			const pending_prediction_t& pending = predicted.pending[d][done];
+			float actual = from + (to - from) * (pending.target > start ? float(pending.target - start) / float(span) : 0.0f);
+			statsRecord(stat_prediction_error, (long long)(std::fabs(pending.predicted - actual) * 10000.0f));
+			statsRecord(stat_unpredicted_error, (long long)(std::fabs(pending.held - actual) * 10000.0f));
+			++done;
+		}
+		predicted.pendingCount[d] -= done;
+		for (int p{ 0 }; p < predicted.pendingCount[d]; ++p) {
+			predicted.pending[d][p] = predicted.pending[d][p + done];
+		}
+	}
+
+	//times in seconds around their mean, the same for every axis
+	float t[predictWindow];
+	float mean = 0.0f;
+	for (int j{ 0 }; j < predictWindow; ++j) {
+		t[j] = float(predicted.times[j] - predicted.times[head]) * 1e-9f;
+		mean += t[j];
+	}
+	mean /= predictWindow;
+	float s2 = 0.0f;
+	for (int j{ 0 }; j < predictWindow; ++j) {
+		t[j] -= mean;
+		s2 += t[j] * t[j];
+	}
+
+	for (int d{ 0 }; d < predicted.count; ++d) {
+		int axis = predicted.axes[d];
+		const inputData& input = inputs[axis];
+		float newest = predicted.values[d][head];
+		float sty = 0.0f;
+		for (int j{ 0 }; j < predictWindow; ++j) {
+			sty += t[j] * (predicted.values[d][j] - newest);
+		}
+		float slope = sty / (s2 + 1e-30f);
+		float horizon = float(device.frameEstimate) * input.predictFrames;
+		float lead = slope * horizon * 1e-9f;
+		lead = std::fmax(-input.predictOvershoot, std::fmin(input.predictOvershoot, lead));
+		float low = input.type == dual ? -1.0f : 0.0f;
+		float output = std::fmax(low, std::fmin(1.0f, newest + lead));
+		predicted.outputs[axis] = output;
+		if (predicted.pendingCount[d] < maxPendingPredictions && device.frameEstimate > 0) {
+			pending_prediction_t& pending = predicted.pending[d][predicted.pendingCount[d]++];
+			pending.target = device.sampleTime + (long long)horizon;
+			pending.predicted = output;
+			pending.held = newest;
+		}
+	}
+}
+
+
+//set once wooting_analog_initialise succeeded, so shutdown only closes a session we opened
+bool sdkInitialised = false;
+//reading snapshots of a WAfAtsBroker, cleared for good once it stops publishing
+bool brokerConnected = false;
+//after the broker stopped, the next time to try opening our own sdk session and the result of the last try
+long long sdkRetryTime = 0;
+int sdkRetryResult = 0;
+const long long sdkRetryNs = 1000000000ll;
+
+//open our own sdk session, false and logged if the sdk fails
+bool initialiseSdk()
+{
+	int WootingResult;
+	WootingResult = wooting_analog_initialise();
+	if (WootingResult >= 0) {
+		log_line(SCS_LOG_TYPE_message, "init wooting analog sdk, devices found = %d", WootingResult);
+		sdkInitialised = true;
+		return true;
+	}
+	else {
+		log_line(SCS_LOG_TYPE_error, "wooting analog sdk init failure, error code = %d", WootingResult);
+		return false;
+	}
+}
+
+//use a running broker if the cfg asks for one, else the sdk directly
+bool connectKeyboard()
+{
+	if (settings.broker) {
+		if (brokerConnect() && brokerAlive()) {
+			brokerConnected = true;
+			log_line(SCS_LOG_TYPE_message, "reading keys from WAfAtsBroker");
+			return true;
+		}
+		brokerDisconnect();
+		log_line(SCS_LOG_TYPE_warning, "no WAfAtsBroker running, reading the sdk directly");
+	}
+	return initialiseSdk();
+}
+
+//open our own sdk session once the broker is gone, called by a frame but tried at most once a second
+//the keys hold their last values until it opens, a failure is only logged when its error code changes
+void reopenSdk(long long now)
+{
+	if (now < sdkRetryTime) {
+		return;
+	}
+	sdkRetryTime = now + sdkRetryNs;
+	int result = wooting_analog_initialise();
+	if (result >= 0) {
+		log_line(SCS_LOG_TYPE_message, "init wooting analog sdk, devices found = %d", result);
+		sdkInitialised = true;
+	}
+	else if (result != sdkRetryResult) {
+		log_line(SCS_LOG_TYPE_error, "wooting analog sdk init failure, error code = %d, trying again every second", result);
+	}
+	sdkRetryResult = result;
+}
+
+//the frame's reads from the latest broker snapshot, every key is in it so on change keys come back as a full buffer of all of them
+//returns false once the broker is gone, the plugin then opens its own sdk session with reopenSdk and reads it directly
+bool readBrokerKeys(key_reads_t& reads)
+{
+	TRACE_SPAN("broker reads");
+	float values[maxBoundKeys];
+	if (!brokerAlive() || !brokerRead(boundKeys.codes, values, boundKeys.count)) {
+		brokerConnected = false;
+		brokerDisconnect();
+		log_line(SCS_LOG_TYPE_error, "WAfAtsBroker stopped publishing, reading the sdk directly");
+		sdkRetryTime = 0;
+		sdkRetryResult = 0;
+		return false;
+	}
+	for (int i{ 0 }; i < boundKeys.count; ++i) {
+		reads.values[i] = values[i];
+	}
+	if (reads.fullBuffer) {
+		reads.fullBufferCount = 0;
+		for (int i{ 0 }; i < boundKeys.count; ++i) {
+			if (values[i] < 0) {
+				reads.fullBufferCount = int(values[i]);
+				break;
+			}
+			if (layers[activeLayer].onChangeAxes[i] != 0 && !(reads.keyMask & (1u << i))) {
+				reads.fullBufferCodes[reads.fullBufferCount] = boundKeys.codes[i];
+				reads.fullBufferValues[reads.fullBufferCount] = values[i];
+				++reads.fullBufferCount;
+			}
+		}
+	}
+	return true;
+}
+
+
+//read the keys of reads from the broker, the sdk or the guarded reader and mark the on change axes that moved as due
+//returns the sdk reads it took
+int readBoundKeys(device_data_t& device, key_reads_t& reads)
+{
+	int sdkReads = countBits(reads.keyMask) + (reads.fullBuffer ? 1 : 0);
+	if (brokerConnected && readBrokerKeys(reads)) {
+		device.dueAxes |= applyKeyReads(reads);
+		//the broker did the reads
+		sdkReads = 0;
+	}
+	else if (!sdkInitialised) {
+		reopenSdk(device.frameStart);
+		sdkReads = 0;
+	}
+	else if (guardedReader == NULL) {
+		readKeys(reads);
+		device.dueAxes |= applyKeyReads(reads);
+	}
+	else if (sampleBoundKeysGuarded(*guardedReader, reads)) {
+		device.dueAxes |= applyKeyReads(reads);
+	}
+	return sdkReads;
+}
+
+//layer of the held modifier key, the last layer in the cfg wins when several are held
+//the active layer's key only has to stay above half the threshold, so a key resting near it doesn't flicker between layers
+int heldLayer()
+{
+	for (int l{ layerCount - 1 }; l > 0; --l) {
+		float threshold = l == activeLayer ? settings.layerThreshold * 0.5f : settings.layerThreshold;
+		if (boundKeys.values[layers[l].modifierIndex] >= threshold) {
+			return l;
+		}
+	}
+	return 0;
+}
 
-//game only has 6 axes to set, 3 single and 3 dual
-//gas, brake, clutch, steer, lookup, lookright
-//should be safe to change if needed(just make sure your imported cfg is adapted as it will try to read more lines)
-const int numOfAxes = 6;
+//pick the axes due this frame and read their keys, every axis and key after a resync
+//the modifier keys are read along, when they pick another layer its keys are read as well and every axis is due
+//so the axes it doesn't drive go back to neutral in this frame, returns true on a layer switch
+bool sampleBoundKeys(device_data_t& device, bool everything)
+{
+	TRACE_SPAN("sampleBoundKeys");
+	key_reads_t reads;
+	device.dueAxes = 0;
+	unsigned int frame = device.frameNumber++;
+	const inputData* inputs = layers[activeLayer].inputs;
+	for (int i{ 0 }; i < numOfAxes; ++i) {
+		const inputData& input = inputs[i];
+		if (input.type == disabled) {
+			continue;
+		}
+		if (!everything) {
+			if (input.rateOnChange) {
+				reads.fullBuffer = true;
+				continue;
+			}
+			if (int(frame % input.ratePeriod) != input.ratePhase) {
+				continue;
+			}
+		}
+		device.dueAxes |= 1u << i;
+		reads.keyMask |= input.keyMask;
+	}
+	reads.keyMask |= boundKeys.modifierMask;
+	int sdkReads = readBoundKeys(device, reads);
 
-// Prints message to game log.
-// SCS_LOG_TYPE_message, SCS_LOG_TYPE_warning, SCS_LOG_TYPE_error
-void log_line(const scs_log_type_t type, const char* const text, ...)
+	int layer = heldLayer();
+	bool switched = layer != activeLayer;
+	if (switched) {
+		activeLayer = layer;
+		statsAdd(stat_layer_switches);
+		//keys of the new layer that weren't read this frame can be from whenever it was last active
+		key_reads_t layerReads;
+		for (int i{ 0 }; i < numOfAxes; ++i) {
+			layerReads.keyMask |= layers[layer].inputs[i].keyMask;
+		}
+		layerReads.keyMask &= ~reads.keyMask;
+		if (layerReads.keyMask != 0) {
+			sdkReads += readBoundKeys(device, layerReads);
+		}
+		device.dueAxes = (1u << numOfAxes) - 1;
+	}
+	device.sampleTime = sampleClock();
+	device.sdkReadsInFrame += sdkReads;
+	statsAdd(stat_sdk_reads, sdkReads);
+	return switched;
+}
+
+
+//move an output towards its target by at most rise units/s away from center and fall units/s towards it
+float slewLimit(float from, float target, float rise, float fall, float seconds)
 {
-	if (!game_log) {
-		return;
+	//right after a resync there is nothing to slew from
+	if (std::isnan(from)) {
+		return target;
 	}
-	char formated[1000];
+	rise = rise > 0.0f ? rise : 1e9f;
+	fall = fall > 0.0f ? fall : 1e9f;
+	float delta = target - from;
+	bool outward = (from >= 0.0f && delta > 0.0f) || (from <= 0.0f && delta < 0.0f);
+	if (outward) {
+		float step = rise * seconds;
+		return std::fabs(delta) <= step ? target : from + std::copysign(step, delta);
+	}
+	//towards center, or through it to the other side
+	bool sameSide = target * from > 0.0f;
+	float inward = sameSide ? std::fabs(delta) : std::fabs(from);
+	float step = fall * seconds;
+	if (step < inward) {
+		return from + std::copysign(step, delta);
+	}
+	if (sameSide || target == 0.0f) {
+		return target;
+	}
+	//the time left after reaching center goes to rising on the other side
+	float riseStep = rise * (seconds - inward / fall);
+	return std::fabs(target) <= riseStep ? target : std::copysign(riseStep, target);
+}
 
-	va_list args;
-	va_start(args, text);
-	vsnprintf_s(formated, sizeof(formated), _TRUNCATE, text, args);
-	formated[sizeof(formated) - 1] = 0;
-	va_end(args);
+//start a frame of the slew limiter: axes still heading for their target are due again,
+//every due slewed axis gets the real time since it last moved
+//on a layer switch the axes the new layer doesn't drive skip the limiter, they are released at once
+void beginSlew(device_data_t& device, bool switched)
+{
+	const inputData* inputs = layers[activeLayer].inputs;
+	for (int i{ 0 }; i < numOfAxes; ++i) {
+		const inputData& input = inputs[i];
+		if (input.slewRise <= 0.0f && input.slewFall <= 0.0f) {
+			continue;
+		}
+		if (device.lastReportedInputValues[i] != device.slewTargets[i]) {
+			device.dueAxes |= 1u << i;
+		}
+		if (device.dueAxes & (1u << i)) {
+			float seconds = float(device.sampleTime - device.slewTimes[i]) * 1e-9f;
+			//a long gap (first frame, after a pause) is no reason to jump
+			device.slewSeconds[i] = seconds < 0.1f ? seconds : 0.1f;
+			device.slewFrom[i] = switched && input.type == disabled ? NAN : device.lastReportedInputValues[i];
+			device.slewTimes[i] = device.sampleTime;
+		}
+	}
+}
 
-	//prefix all of our messages
-	char temp[1000] = "[plugin][WAfAts] ";
-	strcat_s(temp, formated);
-	game_log(type, temp);
+
+//last callback of a registered device's frame
+void endFrame(registered_device_t& registered)
+{
+	long long now = statsNow();
+	int activeAxes = countBits(registered.axes & layers[activeLayer].activeMask);
+	statsAdd(stat_suppressed, activeAxes > registered.eventsInFrame ? activeAxes - registered.eventsInFrame : 0);
+	statsRecord(stat_frame_time, now - registered.frameStart);
+	registered.frameStart = -1;
+	registered.eventsInFrame = 0;
+	statsFrameEnd(AnalogKeyboard.frameStart);
+#ifdef WAFATS_ALLOC_CHECK
+	//the allocation hook can't log, it runs inside malloc
+	static unsigned long long heapCheckReported = 0;
+	if (heapCheckCount() != heapCheckReported) {
+		heapCheckReported = heapCheckCount();
+		log_line(SCS_LOG_TYPE_error, "%llu heap allocations in the input callback since init", heapCheckReported);
+	}
+#endif
 }
 
 
-struct device_data_t
+//run the frame kernel over every axis once the keys are read, the events of the frame are taken from its outputs
+void evaluateAxes(device_data_t& device)
 {
-	int nextReportedInput = 0;
-	float lastReportedInputValues[numOfAxes] = { 0,0,0,0,0,0 };
-};
+	TRACE_SPAN("evaluateAxes");
+	axis_layer_t& layer = layers[activeLayer];
+	frame_kernel_t& kernel = layer.kernel;
+	//the bands around the current speed, the kernel blends between them
+	float speed = telemetrySpeed.load(std::memory_order_relaxed) * settings.speedUnitScale;
+	for (int i{ 0 }; i < numOfAxes; ++i) {
+		const speed_response_t& response = layer.inputs[i].speedResponse;
+		if (response.bands == 0) {
+			continue;
+		}
+		int low = 0;
+		int high = 0;
+		float blend = 0.0f;
+		if (speed >= response.speeds[response.bands - 1]) {
+			low = high = response.bands - 1;
+		}
+		else if (speed > response.speeds[0]) {
+			while (speed >= response.speeds[low + 1]) {
+				++low;
+			}
+			high = low + 1;
+			blend = (speed - response.speeds[low]) / (response.speeds[high] - response.speeds[low]);
+		}
+		kernel.lowTables[i] = (i * maxSpeedBands + low) * responseTableSize;
+		kernel.highTables[i] = (i * maxSpeedBands + high) * responseTableSize;
+		kernel.blends[i] = blend;
+	}
+	for (int i{ 0 }; i < numOfAxes; ++i) {
+		kernel.derived[i] = layer.inputs[i].derive != derive_none ? layer.derived.outputs[i] : layer.predicted.outputs[i];
+		kernel.lastReported[i] = device.lastReportedInputValues[i];
+	}
 
-device_data_t AnalogKeyboard;
+	unsigned int changed = runFrameKernel(kernel, boundKeys.values) & device.dueAxes;
 
-//how many keys for each input axis
-enum inputAxisType {
-	disabled,
-	single,
-	dual,
+	//the slew limiter depends on time and history per axis, it stays scalar after the kernel
+	for (int i{ 0 }; i < numOfAxes; ++i) {
+		const inputData& input = layer.inputs[i];
+		if (!(device.dueAxes & (1u << i)) || (input.slewRise <= 0.0f && input.slewFall <= 0.0f)) {
+			continue;
+		}
+		device.slewTargets[i] = kernel.outputs[i];
+		kernel.outputs[i] = slewLimit(device.slewFrom[i], kernel.outputs[i], input.slewRise, input.slewFall, device.slewSeconds[i]);
+		if (kernel.outputs[i] != device.lastReportedInputValues[i]) {
+			changed |= 1u << i;
+		}
+		else {
+			changed &= ~(1u << i);
+		}
+	}
+	//every device gets its own queue, axes left over from the last frame were due again and are in changed if they still differ
+	for (int d{ 0 }; d < registeredDeviceCount; ++d) {
+		registeredDevices[d].changedAxes = changed & registeredDevices[d].axes;
+	}
+}
+
+//next axis of a registered device whose value changed this frame, lowest axis first
+int getNextKeyChanged(device_data_t& device, registered_device_t& registered)
+{
+	if (registered.changedAxes == 0) {
+		return -1;
+	}
+	int i = 0;
+	while (!(registered.changedAxes & (1u << i))) {
+		++i;
+	}
+	registered.changedAxes &= ~(1u << i);
+	registered.nextReportedAxis = i;
+	registered.nextReportedInput = registered.inputIndex[i];
+	device.lastReportedInputValues[i] = layers[activeLayer].kernel.outputs[i];
+	return i;
+}
+
+
+//tunables of an axis the control pipe can change while driving, everything else needs the game restarted
+struct axis_tuning_t
+{
+	float slewRise;
+	float slewFall;
+	float predictFrames;
+	float predictOvershoot;
+	float deriveScale;
+	speed_response_t speedResponse;
+	float deadzone;
 };
 
-struct inputData
+//tuning published by the control thread, the game thread copies the newest block at the start of a frame
+//two blocks so the next one is written while the last one may still be read, the seqlock catches a reader slow enough to be overtaken twice
+struct tuning_block_t
 {
-	std::string displayName{ "unnamed axis" };
-	unsigned short keyCode1{ 0 };
-	unsigned short keyCode2{ 0 };
-	inputAxisType type{ disabled };
+	std::atomic<unsigned int> seqlock{ 0 };
+	axis_tuning_t axes[maxLayers][numOfAxes];
 };
 
-inputData tableOfInputs[numOfAxes];
+tuning_block_t tuningBlocks[2];
+//newest published version, it is in tuningBlocks[version & 1], 0 = nothing published yet
+std::atomic<unsigned int> tuningVersion{ 0 };
+//version the layers were last built with, game thread only
+unsigned int tuningApplied = 0;
 
-void sanitize(std::string& string, const char* whitelist)
+axis_tuning_t tuningOf(const inputData& input)
 {
-	int badChar = string.find_first_not_of(whitelist);
-	while (badChar >= 0) {
-		string.erase(badChar, 1);
-		badChar = string.find_first_not_of(whitelist);
-	}
+	axis_tuning_t tuning;
+	tuning.slewRise = input.slewRise;
+	tuning.slewFall = input.slewFall;
+	tuning.predictFrames = input.predictFrames;
+	tuning.predictOvershoot = input.predictOvershoot;
+	tuning.deriveScale = input.deriveScale;
+	tuning.speedResponse = input.speedResponse;
+	tuning.deadzone = input.deadzone;
+	return tuning;
 }
 
-//fill tableOfInputs with user configurable inputs
-void importInputs()
+void setTuning(inputData& input, const axis_tuning_t& tuning)
 {
-	const char whitelist[] = "qwertyuiopasdfghjklzxcvbnmQWERTYUIOPASDFGHJKLZXCVBNM1234567890 ._";
-	const char whitelistNum[] = "1234567890";
-	const char separators[] = ",";
+	input.slewRise = tuning.slewRise;
+	input.slewFall = tuning.slewFall;
+	input.predictFrames = tuning.predictFrames;
+	input.predictOvershoot = tuning.predictOvershoot;
+	input.deriveScale = tuning.deriveScale;
+	input.speedResponse = tuning.speedResponse;
+	input.deadzone = tuning.deadzone;
+}
 
-	std::ifstream cfg("plugins/WAfAts.cfg");
-	if (cfg.good()) {
-		//do for each line of cfg
-		for (int i{ 0 }; i < numOfAxes; ++i) {
-			char lineString[50];
-			std::string tempString;
-			char* token = NULL;
-			char* nextToken = NULL;
-
-			cfg.getline(&lineString[0], _countof(lineString));
-			token = strtok_s(lineString, separators, &nextToken);
-			//assign name
-			if (token != NULL)
-			{
-				tempString = token;
-				sanitize(tempString, whitelist);
-				if (!tempString.empty()) {
-					tableOfInputs[i].displayName = tempString;
-				}
-				token = strtok_s(NULL, separators, &nextToken);
-			}
-			//assign key1
-			if (token != NULL)
-			{
-				tempString = token;
-				sanitize(tempString, whitelistNum);
-				if (!tempString.empty()) {
-					tableOfInputs[i].keyCode1 = stoi(tempString);
-					tableOfInputs[i].type = single;
-				}
-				token = strtok_s(NULL, separators, &nextToken);
-			}
-			//assign key2
-			if (token != NULL)
-			{
-				tempString = token;
-				sanitize(tempString, whitelistNum);
-				if (!tempString.empty()) {
-					tableOfInputs[i].keyCode2 = stoi(tempString);
-					tableOfInputs[i].type = dual;
-				}
-			}
-		}
-		log_line(SCS_LOG_TYPE_message, "got user values from cfg file");
-		cfg.close();
-		//printing tableOfInputs, could remove to unclutter log
+//pick up a newly published tuning and rebuild the layers with it, one acquire load when nothing changed
+void applyTuning(device_data_t& device)
+{
+	unsigned int version = tuningVersion.load(std::memory_order_acquire);
+	if (version == tuningApplied) {
+		return;
+	}
+	//the guarded reader uses boundKeys.readOrder, try again next frame if it is still busy
+	if (guardedReader != NULL && guardedReader->completed.load(std::memory_order_acquire) != guardedReader->requested.load(std::memory_order_relaxed)) {
+		return;
+	}
+	//too big for the stack of the game thread
+	static axis_tuning_t staged[maxLayers][numOfAxes];
+	const tuning_block_t& block = tuningBlocks[version & 1];
+	unsigned int before = block.seqlock.load(std::memory_order_acquire);
+	if (before & 1) {
+		return;
+	}
+	memcpy(staged, block.axes, sizeof(staged));
+	std::atomic_thread_fence(std::memory_order_acquire);
+	//overwritten while we copied, there is a newer version for the next frame
+	if (block.seqlock.load(std::memory_order_relaxed) != before) {
+		return;
+	}
+	TRACE_SPAN("applyTuning");
+	for (int l{ 0 }; l < layerCount; ++l) {
 		for (int i{ 0 }; i < numOfAxes; ++i) {
-			log_line(SCS_LOG_TYPE_message, "imported name %i is %s", i, tableOfInputs[i].displayName.c_str());
-			log_line(SCS_LOG_TYPE_message, "imported key1 %i is %u", i, tableOfInputs[i].keyCode1);
-			log_line(SCS_LOG_TYPE_message, "imported key2 %i is %u", i, tableOfInputs[i].keyCode2);
-			log_line(SCS_LOG_TYPE_message, "imported type %i is %i", i, tableOfInputs[i].type);
+			setTuning(layers[l].inputs[i], staged[l][i]);
 		}
 	}
-	else {
-		log_line(SCS_LOG_TYPE_warning, "failure reading cfg file, using default keys (WASD)");
-		tableOfInputs[1] =	{"Analog key W", 26, 0, single};
-		tableOfInputs[2] = {"Analog key S", 22, 0, single};
-		tableOfInputs[3] = {"Analog key AD", 4, 7, dual};
-	}
-};
+	//a prediction turned on or off changes what is read every frame and which lanes the kernel leaves alone
+	buildSchedule();
+	buildDerivedAxes();
+	buildPredictedAxes();
+	buildFrameKernel();
+	device.resync = true;
+	tuningApplied = version;
+	log_line(SCS_LOG_TYPE_message, "applied tuning version %u", version);
+}
+
 
+//control thread state, the tuning as the pipe set it and as it is in the cfg file
+axis_tuning_t controlTuning[maxLayers][numOfAxes];
+axis_tuning_t controlSaved[maxLayers][numOfAxes];
+int controlLayerCount = 1;
+unsigned short controlModifierCodes[maxLayers] = {};
+bool controlModifierNamed[maxLayers] = {};
+//layer that get and set work on
+int controlLayer = 0;
+unsigned int controlVersion = 0;
 
-//read an analog key or handle error
-float readDevicePressed(unsigned short keyCode)
+//game thread, before the control thread starts
+void controlSnapshot()
 {
-	float keyValue;
-	keyValue = wooting_analog_read_analog(keyCode);
-	if (keyValue >= 0) { return keyValue; }
-	else {
-		log_line(SCS_LOG_TYPE_error, "failure reading analog key value, error code = %f", keyValue);
-		return 0.0;
+	for (int l{ 0 }; l < layerCount; ++l) {
+		for (int i{ 0 }; i < numOfAxes; ++i) {
+			controlTuning[l][i] = tuningOf(layers[l].inputs[i]);
+			controlSaved[l][i] = controlTuning[l][i];
+		}
+		controlModifierCodes[l] = layers[l].modifierCode;
+		controlModifierNamed[l] = layers[l].modifierNamed;
 	}
+	controlLayerCount = layerCount;
+	controlLayer = 0;
+	controlVersion = 0;
+	tuningVersion.store(0, std::memory_order_relaxed);
+	tuningApplied = 0;
 }
 
+void publishTuning()
+{
+	unsigned int version = controlVersion + 1;
+	tuning_block_t& block = tuningBlocks[version & 1];
+	unsigned int lock = block.seqlock.load(std::memory_order_relaxed);
+	block.seqlock.store(lock + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	memcpy(block.axes, controlTuning, sizeof(block.axes));
+	block.seqlock.store(lock + 2, std::memory_order_release);
+	tuningVersion.store(version, std::memory_order_release);
+	controlVersion = version;
+}
 
-//2 inputs 0 to 1, 1 output -1 to 1
-//A and D need to be the same axis with D being positive and A negative
-//set to output the greater value if both are partially pressed or no value if equally pressed
-float calculateSharedAxis(float left, float right)
+//value of a tuning setting as it is written in the cfg, empty for a speed_response that isn't set
+std::string formatTuning(const axis_tuning_t& tuning, const std::string& name)
 {
-	if (left == right) { return 0.0; }
-	else if (left > right) { return -left; }
-	else { return right; }
+	char value[200] = "";
+	if (name == "slew") {
+		snprintf(value, sizeof(value), "%g %g", tuning.slewRise, tuning.slewFall);
+	}
+	else if (name == "predict") {
+		snprintf(value, sizeof(value), "%g", tuning.predictFrames);
+	}
+	else if (name == "predict_overshoot") {
+		snprintf(value, sizeof(value), "%g", tuning.predictOvershoot);
+	}
+	else if (name == "derive_scale") {
+		snprintf(value, sizeof(value), "%g", tuning.deriveScale);
+	}
+	else if (name == "deadzone") {
+		snprintf(value, sizeof(value), "%g", tuning.deadzone);
+	}
+	else if (name == "speed_response") {
+		const speed_response_t& response = tuning.speedResponse;
+		int length = 0;
+		for (int b{ 0 }; b < response.bands; ++b) {
+			length += snprintf(value + length, sizeof(value) - length, "%s%g %g %g", b > 0 ? ", " : "", response.speeds[b], response.gains[b], response.exponents[b]);
+		}
+	}
+	return value;
 }
 
+//split 'name N' into the name and the 0 based input, -1 if there is no number
+int settingInput(const std::string& fullName, std::string& name)
+{
+	size_t space = fullName.find_last_of(' ');
+	if (space == std::string::npos) {
+		name = fullName;
+		return -1;
+	}
+	name = fullName.substr(0, space);
+	name.erase(name.find_last_not_of(' ') + 1);
+	return atoi(fullName.c_str() + space + 1) - 1;
+}
 
-//get key value based on input type
-int getNextKeyChanged(device_data_t& device)
+//rewrite the tuning that changed since the cfg was loaded or last saved into plugins/WAfAts.cfg
+//the line that sets a value for the picked profile is replaced, a value without one gets a new line after the last line of its layer
+bool controlSave(std::string& reply)
 {
-	for (int i{0}; i < numOfAxes; ++i) {
-		float currentValue = 0;
+	std::ifstream file("plugins/WAfAts.cfg", std::ios::binary);
+	if (!file.good()) {
+		reply = "error: failure reading plugins/WAfAts.cfg\n";
+		return false;
+	}
+	std::ostringstream text;
+	text << file.rdbuf();
+	file.close();
+	//every line with its line break, so lines we don't touch are written back as they were
+	std::vector<std::string> lines;
+	std::string all = text.str();
+	for (size_t start{ 0 }; start < all.size();) {
+		size_t end = all.find('\n', start);
+		end = end == std::string::npos ? all.size() : end + 1;
+		lines.push_back(all.substr(start, end - start));
+		start = end;
+	}
+	if (lines.size() < size_t(numOfAxes)) {
+		reply = "error: plugins/WAfAts.cfg has no inputs\n";
+		return false;
+	}
+	const char* lineBreak = all.find("\r\n") != std::string::npos ? "\r\n" : "\n";
+
+	//walk the settings like importInputs, remembering the last line setting every tunable and the last line of every layer
+	const int tuningCount = int(sizeof(tuningNames) / sizeof(tuningNames[0]));
+	static int setBy[maxLayers][numOfAxes][tuningCount];
+	int insertAt[maxLayers];
+	for (int l{ 0 }; l < maxLayers; ++l) {
+		insertAt[l] = l == 0 ? numOfAxes : -1;
+		for (int i{ 0 }; i < numOfAxes; ++i) {
+			for (int t{ 0 }; t < tuningCount; ++t) {
+				setBy[l][i][t] = -1;
+			}
+		}
+	}
+	std::string section;
+	std::string layerSection;
+	int sectionLayer = 0;
+	for (int j{ numOfAxes }; j < int(lines.size()) && lines[j].compare(0, 2, "//") != 0; ++j) {
+		std::string settingLine = lines[j];
+		size_t equals = settingLine.find('=');
+		if (equals == std::string::npos) {
+			if (settingLine.compare(0, 8, "profile ") == 0) {
+				section = settingLine.substr(8);
+				sanitize(section, whitelist);
+				section.erase(section.find_last_not_of(' ') + 1);
+				layerSection.clear();
+			}
+			else if (settingLine.compare(0, 6, "layer ") == 0) {
+				layerSection = settingLine.substr(6);
+				sanitize(layerSection, whitelistKey);
+			}
+			else {
+				continue;
+			}
+			sectionLayer = -1;
+			if (section.empty() || section == settings.profile) {
+				sectionLayer = layerSection.empty() ? 0 : -1;
+				unsigned short code = 0;
+				bool named = false;
+				for (int l{ 1 }; l < controlLayerCount && !layerSection.empty(); ++l) {
+					if (parseKey(layerSection, code, named) && code == controlModifierCodes[l] && named == controlModifierNamed[l]) {
+						sectionLayer = l;
+					}
+				}
+			}
+			if (sectionLayer >= 0) {
+				insertAt[sectionLayer] = j + 1;
+			}
+			continue;
+		}
+		if (sectionLayer < 0) {
+			continue;
+		}
+		insertAt[sectionLayer] = j + 1;
+		std::string fullName = settingLine.substr(0, equals);
+		sanitize(fullName, whitelist);
+		fullName.erase(0, fullName.find_first_not_of(' '));
+		fullName.erase(fullName.find_last_not_of(' ') + 1);
+		std::string name;
+		int axis = settingInput(fullName, name);
+		for (int t{ 0 }; t < tuningCount && axis >= 0 && axis < numOfAxes; ++t) {
+			if (name == tuningNames[t]) {
+				setBy[sectionLayer][axis][t] = j;
+			}
+		}
+	}
+
+	std::vector<std::string> inserted(lines.size() + 1);
+	int saved = 0;
+	for (int l{ 0 }; l < controlLayerCount; ++l) {
+		for (int i{ 0 }; i < numOfAxes; ++i) {
+			for (int t{ 0 }; t < tuningCount; ++t) {
+				std::string value = formatTuning(controlTuning[l][i], tuningNames[t]);
+				if (value == formatTuning(controlSaved[l][i], tuningNames[t])) {
+					continue;
+				}
+				std::string line = std::string(tuningNames[t]) + " " + std::to_string(i + 1) + " = " + value;
+				int j = setBy[l][i][t];
+				if (j >= 0) {
+					size_t end = lines[j].find_last_not_of("\r\n") + 1;
+					lines[j] = line + lines[j].substr(end);
+				}
+				else if (insertAt[l] >= 0) {
+					inserted[insertAt[l]] += line + lineBreak;
+				}
+				else {
+					reply = "error: layer " + std::to_string(l) + " has no section in plugins/WAfAts.cfg\n";
+					return false;
+				}
+				++saved;
+			}
+		}
+	}
+	if (!inserted[lines.size()].empty() && lines.back().back() != '\n') {
+		lines.back() += lineBreak;
+	}
+
+	FILE* out = NULL;
+	if (fopen_s(&out, "plugins/WAfAts.cfg.tmp", "wb") != 0 || out == NULL) {
+		reply = "error: failure writing plugins/WAfAts.cfg.tmp\n";
+		return false;
+	}
+	bool written = true;
+	for (size_t j{ 0 }; j <= lines.size(); ++j) {
+		written = written && fwrite(inserted[j].data(), 1, inserted[j].size(), out) == inserted[j].size();
+		if (j < lines.size()) {
+			written = written && fwrite(lines[j].data(), 1, lines[j].size(), out) == lines[j].size();
+		}
+	}
+	written = fclose(out) == 0 && written;
+#ifdef _WIN32
+	written = written && MoveFileExA("plugins/WAfAts.cfg.tmp", "plugins/WAfAts.cfg", MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+#else
+	written = written && rename("plugins/WAfAts.cfg.tmp", "plugins/WAfAts.cfg") == 0;
+#endif
+	if (!written) {
+		reply = "error: failure writing plugins/WAfAts.cfg\n";
+		return false;
+	}
+	for (int l{ 0 }; l < controlLayerCount; ++l) {
+		std::copy(controlTuning[l], controlTuning[l] + numOfAxes, controlSaved[l]);
+	}
+	reply = "saved " + std::to_string(saved) + " settings to plugins/WAfAts.cfg\n";
+	return true;
+}
 
-		if (tableOfInputs[i].type == single) {
-			currentValue = readDevicePressed(tableOfInputs[i].keyCode1);
+//one line from the control pipe, runs on the control thread
+std::string controlCommand(const std::string& line)
+{
+	std::istringstream words(line);
+	std::string command;
+	words >> command;
+	if (command.empty()) {
+		return "";
+	}
+	if (command == "help") {
+		return "layer [n]                     pick the layer get and set work on, 0 = base\n"
+			"get [input]                   settings of every input or one, as cfg lines\n"
+			"set <name> <input> = <value>  same as the cfg line, for slew, predict, predict_overshoot, derive_scale, speed_response and deadzone\n"
+			"stats                         the stats summary so far\n"
+			"export                        write the full stats with histograms to plugins/WAfAts.stats.txt now\n"
+			"save                          write what was set into plugins/WAfAts.cfg\n";
+	}
+	if (command == "layer") {
+		int layer = 0;
+		if (words >> layer) {
+			if (layer < 0 || layer >= controlLayerCount) {
+				return "error: layer " + std::to_string(layer) + " doesn't exist, there are " + std::to_string(controlLayerCount) + "\n";
+			}
+			controlLayer = layer;
+		}
+		return "layer " + std::to_string(controlLayer) + "\n";
+	}
+	if (command == "get") {
+		int first = 0;
+		int last = numOfAxes;
+		int input = 0;
+		if (words >> input) {
+			if (input < 1 || input > numOfAxes) {
+				return "error: input " + std::to_string(input) + " isn't between 1 and " + std::to_string(numOfAxes) + "\n";
+			}
+			first = input - 1;
+			last = input;
+		}
+		std::string reply;
+		for (int i{ first }; i < last; ++i) {
+			for (const char* name : tuningNames) {
+				std::string value = formatTuning(controlTuning[controlLayer][i], name);
+				if (!value.empty()) {
+					reply += std::string(name) + " " + std::to_string(i + 1) + " = " + value + "\n";
+				}
+			}
 		}
-		else if (tableOfInputs[i].type == dual) {
-			currentValue = calculateSharedAxis(readDevicePressed(tableOfInputs[i].keyCode1), readDevicePressed(tableOfInputs[i].keyCode2));
+		return reply;
+	}
+	if (command == "set") {
+		std::string setting = line.substr(line.find("set") + 3);
+		size_t equals = setting.find('=');
+		if (equals == std::string::npos) {
+			return "error: expected 'set <name> <input> = <value>'\n";
+		}
+		std::string fullName = setting.substr(0, equals);
+		std::string value = setting.substr(equals + 1);
+		sanitize(fullName, whitelist);
+		sanitize(value, whitelistSetting);
+		fullName.erase(0, fullName.find_first_not_of(' '));
+		fullName.erase(fullName.find_last_not_of(' ') + 1);
+		value.erase(0, value.find_first_not_of(' '));
+		value.erase(value.find_last_not_of(' ') + 1);
+		std::string name;
+		int axis = settingInput(fullName, name);
+		if (!isTuning(name)) {
+			return "error: '" + name + "' can't be set while driving\n";
+		}
+		if (axis < 0 || axis >= numOfAxes) {
+			return "error: '" + fullName + "' needs an input between 1 and " + std::to_string(numOfAxes) + "\n";
+		}
+		inputData input;
+		setTuning(input, controlTuning[controlLayer][axis]);
+		std::string error;
+		if (!importTuning(input, name, value, error)) {
+			return "error: " + error + "\n";
 		}
+		controlTuning[controlLayer][axis] = tuningOf(input);
+		publishTuning();
+		return name + " " + std::to_string(axis + 1) + " = " + formatTuning(controlTuning[controlLayer][axis], name) + "\n";
+	}
+	if (command == "stats") {
+		return statsSummaryText();
+	}
+	if (command == "export") {
+		//its own temporary, a summary export of the game thread may be writing the file at the same time
+		if (!statsExportSnapshot("plugins/WAfAts.stats.txt", "plugins/WAfAts.stats.control.tmp")) {
+			return "error: failure writing plugins/WAfAts.stats.txt\n";
+		}
+		return "stats written to plugins/WAfAts.stats.txt\n";
+	}
+	if (command == "save") {
+		std::string reply;
+		controlSave(reply);
+		return reply;
+	}
+	return "error: unknown command '" + command + "', try help\n";
+}
 
-		if (currentValue != device.lastReportedInputValues[i]) {
-			device.nextReportedInput = i;
-			device.lastReportedInputValues[i] = currentValue;
-			return i;
+
+//read the keyboard and evaluate every axis, once per frame for all registered devices
+void takeSnapshot(device_data_t& device)
+{
+	device.frameStart = sampleClock();
+	updateFrameEstimate(device);
+#ifdef _WIN32
+	checkKeyboardLayout(device);
+#endif
+	applyTuning(device);
+	//whatever the game kept from before the pause is stale, send the current value of every axis
+	bool resync = device.resync;
+	if (resync) {
+		device.resync = false;
+		for (int i{ 0 }; i < numOfAxes; ++i) {
+			device.lastReportedInputValues[i] = NAN;
 		}
 	}
-	return -1;
+	//axes a device didn't get to report yet go out with this frame's value
+	unsigned int unreported = 0;
+	for (int d{ 0 }; d < registeredDeviceCount; ++d) {
+		unreported |= registeredDevices[d].changedAxes;
+	}
+	//a layer switch starts the rings of the new layer over like a resync
+	bool switched = sampleBoundKeys(device, resync);
+	device.dueAxes |= unreported;
+	updateDerivedAxes(device, resync || switched);
+	updatePredictedAxes(device, resync || switched);
+	beginSlew(device, switched);
+	evaluateAxes(device);
+	if (recordingEnabled) {
+		recordingFrame(device.sampleTime, telemetrySpeed.load(std::memory_order_relaxed), resync ? recording_frame_resync : 0, boundKeys.values);
+	}
+	++device.snapshot;
+	statsAdd(stat_frames);
+	statsRecord(stat_sdk_reads_per_frame, device.sdkReadsInFrame);
+	device.sdkReadsInFrame = 0;
 }
 
 
 //called repeatedly until it returns SCS_RESULT_not_found
 SCSAPI_RESULT input_event_callback(scs_input_event_t* const event_info, const scs_u32_t flags, const scs_context_t context)
 {
-	device_data_t& device = *static_cast<device_data_t*>(context);
+	TRACE_SPAN("input_event_callback");
+	HEAP_CHECK();
+	registered_device_t& registered = *static_cast<registered_device_t*>(context);
+	device_data_t& device = AnalogKeyboard;
 
 	if (flags & SCS_INPUT_EVENT_CALLBACK_FLAG_first_after_activation) {
 		log_line(SCS_LOG_TYPE_message, "First call after activation");
+		device.resync = true;
 	}
 
 	//also seems to be called if event_info.value is changed
 	if (flags & SCS_INPUT_EVENT_CALLBACK_FLAG_first_in_frame) {
+		//nobody uses the axes while the game is paused (menu, map, loading screen), don't touch the sdk at all
+		if (settings.pauseSampling && telemetryActive.load(std::memory_order_relaxed) && telemetryPaused.load(std::memory_order_relaxed)) {
+			device.resync = true;
+			//a good moment for file io
+			if (calibrationEnabled) {
+				calibrationSave();
+			}
+			recordingFlush();
+			return SCS_RESULT_not_found;
+		}
+		TRACE_FRAME_BEGIN();
+		//the sdk is read once at the start of a frame, the following calls report the rest of that snapshot
+		//with several devices the first one called in a frame takes it and the others report from it too
+		if (registered.frameStart < 0) {
+			registered.frameStart = statsNow();
+			if (registered.snapshot == device.snapshot) {
+				takeSnapshot(device);
+			}
+			registered.snapshot = device.snapshot;
+		}
 		//if no inputs changed
-		if (getNextKeyChanged(device) < 0) {
+		if (getNextKeyChanged(device, registered) < 0) {
+			endFrame(registered);
+			TRACE_FRAME_END();
 			return SCS_RESULT_not_found;
 		}
 	}
 	//update a changed value
-	event_info->input_index = device.nextReportedInput;
-	event_info->value_float.value = device.lastReportedInputValues[device.nextReportedInput];
+	event_info->input_index = registered.nextReportedInput;
+	event_info->value_float.value = device.lastReportedInputValues[registered.nextReportedAxis];
+	++registered.eventsInFrame;
+	statsAdd(stat_events);
+	statsRecord(stat_sample_to_event, statsNow() - device.sampleTime);
 	return SCS_RESULT_ok;
 }
 
@@ -273,51 +2820,99 @@ SCSAPI_RESULT scs_input_init(const scs_u32_t version, const scs_input_init_param
 	}
 
 
-	//setup wooting sdk
-	int WootingResult;
-	WootingResult = wooting_analog_initialise();
-	if (WootingResult >= 0) {
-		log_line(SCS_LOG_TYPE_message, "init wooting analog sdk, devices found = %d", WootingResult);
-	}
-	else {
-		log_line(SCS_LOG_TYPE_error, "wooting analog sdk init failure, error code = %d", WootingResult);
-		return SCS_RESULT_generic_error;
-	}
-
-
 	//setup ingame input type and names
 	scs_input_device_input_t inputs[numOfAxes];
 
 	//get user configurable inputs from cfg
-	importInputs();
+#ifdef WAFATS_TRACE
+	long long importBegin = traceNow();
+#endif
+	loadInputs(version_params->common.game_id);
+	if (!buildTables()) {
+		return SCS_RESULT_generic_error;
+	}
+	buildDerivedAxes();
+	buildPredictedAxes();
+	buildRegisteredDevices();
+#ifdef WAFATS_TRACE
+	long long importEnd = traceNow();
+#endif
+
+	//setup wooting sdk, or a broker that already has it open, after the cfg so we know which one is wanted
+	if (!connectKeyboard()) {
+		return SCS_RESULT_generic_error;
+	}
+	selectFrameKernel();
+	//the buffers the cfg asks for, everything else the frames use is sized at compile time
+	size_t arenaBytes = statsArenaBytes(settings.statsExport) + (settings.record ? recordingArenaBytes + alignof(recording_frame_t) : 0);
+	if (!heapArenaInit(arenaBytes)) {
+		log_line(SCS_LOG_TYPE_warning, "failure allocating %zu bytes for buffers, not recording or exporting stats", arenaBytes);
+	}
+	statsInit(settings.statsSummaryS, settings.statsExport);
+	calibrationEnabled = settings.calibrate;
+	if (calibrationEnabled) {
+		calibrationLoad();
+	}
+	if (settings.record) {
+		recordingStart("plugins/WAfAts.rec", boundKeys.codes, boundKeys.count, calibrationEnabled);
+	}
+#ifdef WAFATS_TRACE
+	traceInit(settings.trace, settings.traceTriggerUs);
+	//the cfg has to be parsed before we know if tracing is wanted
+	if (traceEnabled) {
+		traceRecord("loadInputs", importBegin, importEnd);
+	}
+#endif
+	if (settings.guardedReadUs > 0) {
+		startGuardedReader();
+	}
+	if (settings.control) {
+		controlSnapshot();
+		controlStart(controlCommand);
+	}
 
-	//populate inputs[]
+	//populate inputs[], input names keep the axis number whatever device the axis is on so bindings survive a split
 	std::string tempString[numOfAxes];
 	for (int i{ 0 }; i < numOfAxes; ++i) {
 		tempString[i] = ("woot" + std::to_string(i));
-		inputs[i].name = tempString[i].c_str();
-		inputs[i].display_name = tableOfInputs[i].displayName.c_str();
-		inputs[i].value_type = SCS_VALUE_TYPE_float;
-	}
-
-	scs_input_device_t device_info;
-	device_info.name = "wootdevice";
-	device_info.display_name = "Wooting Analog sdk Device";
-	device_info.type = SCS_INPUT_DEVICE_TYPE_generic;
-	device_info.input_count = numOfAxes;
-	device_info.inputs = inputs;
-	device_info.input_active_callback = NULL;
-	device_info.input_event_callback = input_event_callback;
-	device_info.callback_context = &AnalogKeyboard;
-
-	if (version_params->register_device(&device_info) != SCS_RESULT_ok) {
-
-		// Registrations created by unsuccessfull initialization are
-		// cleared automatically so we can simply exit.
-		log_line(SCS_LOG_TYPE_error, "Unable to register device");
-		return SCS_RESULT_generic_error;
+	}
+	for (int d{ 0 }; d < registeredDeviceCount; ++d) {
+		registered_device_t& registered = registeredDevices[d];
+		for (int i{ 0 }; i < numOfAxes; ++i) {
+			if (!(registered.axes & (1u << i))) {
+				continue;
+			}
+			scs_input_device_input_t& input = inputs[registered.inputIndex[i]];
+			input.name = tempString[i].c_str();
+			input.display_name = layers[0].inputs[i].displayName.c_str();
+			input.value_type = SCS_VALUE_TYPE_float;
+		}
+
+		scs_input_device_t device_info;
+		device_info.name = registered.name.c_str();
+		device_info.display_name = registered.displayName.c_str();
+		device_info.type = SCS_INPUT_DEVICE_TYPE_generic;
+		device_info.input_count = registered.inputCount;
+		device_info.inputs = inputs;
+		device_info.input_active_callback = NULL;
+		device_info.input_event_callback = input_event_callback;
+		device_info.callback_context = &registered;
+
+		if (version_params->register_device(&device_info) != SCS_RESULT_ok) {
+
+			// Registrations created by unsuccessfull initialization are
+			// cleared automatically so we can simply exit.
+			log_line(SCS_LOG_TYPE_error, "Unable to register device %s", registered.name.c_str());
+			controlStop();
+			stopGuardedReader();
+			return SCS_RESULT_generic_error;
+		}
 	}
 
+#ifdef WAFATS_ALLOC_CHECK
+	//from here on the input callback must not touch the heap
+	heapCheckArm();
+#endif
 	return SCS_RESULT_ok;
 }
 
@@ -326,7 +2921,28 @@ SCSAPI_RESULT scs_input_init(const scs_u32_t version, const scs_input_init_param
 SCSAPI_VOID scs_input_shutdown(void)
 {
 	// Any cleanup needed. The registrations will be removed automatically.
-	wooting_analog_uninitialise();
+#ifdef WAFATS_ALLOC_CHECK
+	heapCheckDisarm();
+#endif
+	controlStop();
+	stopGuardedReader();
+	if (calibrationEnabled) {
+		calibrationSave();
+	}
+	recordingStop();
+	statsShutdown();
+	heapArenaRelease();
+#ifdef WAFATS_TRACE
+	traceShutdown();
+#endif
+	if (brokerConnected) {
+		brokerConnected = false;
+		brokerDisconnect();
+	}
+	if (sdkInitialised) {
+		sdkInitialised = false;
+		wooting_analog_uninitialise();
+	}
 	game_log = NULL;
 }
 
@@ -0,0 +1,71 @@
+/*
+* Broker mode, one WAfAtsBroker process owns the Wooting sdk session and publishes key snapshots in shared memory
+* so ats, ets2 and tools running next to them cost one poll loop instead of one each
+*/
+#pragma once
+
+#include <atomic>
+
+//names of the shared memory, of the event set after every published snapshot and of the mutex held by a running broker
+#define BROKER_MAPPING_NAME "Local\\WAfAtsBroker"
+#define BROKER_EVENT_NAME "Local\\WAfAtsBrokerSample"
+#define BROKER_RUNNING_NAME "Local\\WAfAtsBrokerRunning"
+
+const unsigned int brokerMagic = 0x4b524257;
+const unsigned int brokerVersion = 1;
+//one value per hid code
+const int brokerKeys = 256;
+//snapshots kept, a reader only ever copies the latest but a slow one still gets a whole one
+const int brokerRingSize = 16;
+//a broker that hasn't published for this long is gone or hung
+const int brokerStaleMs = 100;
+
+//one sample of the whole keyboard
+//seqlock is odd while the broker writes the slot, a reader retries if it changed under it
+struct broker_snapshot_t
+{
+	std::atomic<unsigned int> seqlock;
+	unsigned long long sequence;
+	//QueryPerformanceCounter ticks when the sample was taken
+	long long time;
+	//WootingAnalogResult of the read, values are only good when it isn't negative
+	int result;
+	float values[brokerKeys];
+};
+
+//everything in the mapping, written only by the broker
+struct broker_shared_t
+{
+	unsigned int magic;
+	unsigned int version;
+	//QueryPerformanceCounter ticks and frequency of the last publish
+	std::atomic<long long> heartbeat;
+	long long frequency;
+	//sequence of the newest complete snapshot, it lives in ring[latest % brokerRingSize]
+	std::atomic<unsigned long long> latest;
+	broker_snapshot_t ring[brokerRingSize];
+};
+
+//the mapping is shared between processes, so the atomics can't hide a lock
+//the macros rather than is_always_lock_free, the plugin project still builds as c++14
+static_assert(ATOMIC_INT_LOCK_FREE == 2, "broker seqlock needs lock free atomics");
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "broker heartbeat and sequence need lock free atomics");
+
+
+//client side, used by the plugin and by tools
+
+//open the mapping of a running broker, false if there is none or it is a different version
+bool brokerConnect();
+
+void brokerDisconnect();
+
+//true while connected and the broker published within brokerStaleMs
+bool brokerAlive();
+
+//copy the latest values of the given hid codes, or the read error into every value
+//returns false if no consistent snapshot could be copied
+bool brokerRead(const unsigned short* codes, float* values, int count);
+
+//wait until a snapshot newer than sequence is published, for tools that want every sample
+//returns the newest sequence, or sequence again on a timeout
+unsigned long long brokerWait(unsigned long long sequence, unsigned int timeoutMs);
@@ -0,0 +1,116 @@
+/*
+* Broker mode, one WAfAtsBroker process owns the Wooting sdk session and publishes key snapshots in shared memory
+* client side, reads the snapshots without any sdk calls
+*/
+
+// Windows stuff.
+#ifdef _WIN32
+#  define WINVER 0x0500
+#  define _WIN32_WINNT 0x0500
+#  include <windows.h>
+#endif
+
+#include "WAfAtsBroker.h"
+
+#define UNUSED(x)
+
+//a snapshot torn by the broker this many times in a row means it is stuck half way through a write
+const int brokerReadRetries = 8;
+
+#ifdef _WIN32
+
+HANDLE brokerMapping = NULL;
+HANDLE brokerEvent = NULL;
+const broker_shared_t* brokerShared = NULL;
+
+bool brokerConnect()
+{
+	brokerMapping = OpenFileMappingA(FILE_MAP_READ, FALSE, BROKER_MAPPING_NAME);
+	if (brokerMapping == NULL) {
+		return false;
+	}
+	brokerShared = static_cast<const broker_shared_t*>(MapViewOfFile(brokerMapping, FILE_MAP_READ, 0, 0, sizeof(broker_shared_t)));
+	if (brokerShared == NULL || brokerShared->magic != brokerMagic || brokerShared->version != brokerVersion) {
+		brokerDisconnect();
+		return false;
+	}
+	brokerEvent = OpenEventA(SYNCHRONIZE, FALSE, BROKER_EVENT_NAME);
+	return true;
+}
+
+void brokerDisconnect()
+{
+	if (brokerShared != NULL) {
+		UnmapViewOfFile(brokerShared);
+		brokerShared = NULL;
+	}
+	if (brokerMapping != NULL) {
+		CloseHandle(brokerMapping);
+		brokerMapping = NULL;
+	}
+	if (brokerEvent != NULL) {
+		CloseHandle(brokerEvent);
+		brokerEvent = NULL;
+	}
+}
+
+bool brokerAlive()
+{
+	if (brokerShared == NULL) {
+		return false;
+	}
+	LARGE_INTEGER now;
+	QueryPerformanceCounter(&now);
+	long long age = now.QuadPart - brokerShared->heartbeat.load(std::memory_order_acquire);
+	return age < brokerShared->frequency * brokerStaleMs / 1000;
+}
+
+bool brokerRead(const unsigned short* codes, float* values, int count)
+{
+	if (brokerShared == NULL) {
+		return false;
+	}
+	for (int attempt{ 0 }; attempt < brokerReadRetries; ++attempt) {
+		unsigned long long sequence = brokerShared->latest.load(std::memory_order_acquire);
+		const broker_snapshot_t& snapshot = brokerShared->ring[sequence % brokerRingSize];
+		unsigned int before = snapshot.seqlock.load(std::memory_order_acquire);
+		if (before & 1) {
+			continue;
+		}
+		int result = snapshot.result;
+		for (int i{ 0 }; i < count; ++i) {
+			values[i] = result < 0 ? float(result) : snapshot.values[codes[i] % brokerKeys];
+		}
+		bool current = snapshot.sequence == sequence;
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (current && snapshot.seqlock.load(std::memory_order_relaxed) == before) {
+			return true;
+		}
+	}
+	return false;
+}
+
+unsigned long long brokerWait(unsigned long long sequence, unsigned int timeoutMs)
+{
+	if (brokerShared == NULL) {
+		return sequence;
+	}
+	unsigned long long latest = brokerShared->latest.load(std::memory_order_acquire);
+	//the broker resets the event before it publishes, so a set event always means something newer is there
+	if (latest == sequence && brokerEvent != NULL) {
+		WaitForSingleObject(brokerEvent, timeoutMs);
+		latest = brokerShared->latest.load(std::memory_order_acquire);
+	}
+	return latest;
+}
+
+#else
+
+//the broker is windows only, everywhere else the plugin reads the sdk directly
+bool brokerConnect() { return false; }
+void brokerDisconnect() {}
+bool brokerAlive() { return false; }
+bool brokerRead(const unsigned short* UNUSED(codes), float* UNUSED(values), int UNUSED(count)) { return false; }
+unsigned long long brokerWait(unsigned long long sequence, unsigned int UNUSED(timeoutMs)) { return sequence; }
+
+#endif
@@ -0,0 +1,143 @@
+/*
+* Per-key travel calibration, learns where every key rests and tops out and stretches that to 0 to 1
+*/
+
+#include "WAfAtsCalibration.h"
+#include "WAfAtsHeap.h"
+
+#include <cmath>
+#include <cstdio>
+
+#include "ScsSdk/include/scssdk.h"
+
+void log_line(const scs_log_type_t type, const char* const text, ...);
+
+//a value only counts once it held still for a few samples, so a glitch or a key passing through doesn't move the calibration
+const int calibrationStableSamples = 4;
+const float calibrationStableBand = 0.005f;
+//resting values above this or topped out values below it are a key held part way, not its real extent
+const float calibrationMaxRest = 0.1f;
+const float calibrationMinTop = 0.85f;
+
+const unsigned int calibrationMagic = 0x4c414357;
+const unsigned int calibrationVersion = 2;
+const int calibrationKeys = 256;
+
+bool calibrationEnabled = false;
+
+//what goes into plugins/WAfAts.calibration
+//NAN until learned, 0 and 1 are values a key can really rest and top out at
+struct calibration_file_t
+{
+	unsigned int magic;
+	unsigned int version;
+	unsigned int keys;
+	float rests[calibrationKeys];
+	float tops[calibrationKeys];
+};
+
+calibration_file_t calibration;
+//value = (raw - offset) * scale, 0 and 1 stand in for a rest or top that wasn't learned yet
+float calibrationOffsets[calibrationKeys];
+float calibrationScales[calibrationKeys];
+float calibrationLast[calibrationKeys];
+unsigned char calibrationStable[calibrationKeys];
+bool calibrationDirty = false;
+
+void calibrationUpdate(int code)
+{
+	float rest = std::isnan(calibration.rests[code]) ? 0.0f : calibration.rests[code];
+	float top = std::isnan(calibration.tops[code]) ? 1.0f : calibration.tops[code];
+	calibrationOffsets[code] = rest;
+	calibrationScales[code] = 1.0f / (top - rest);
+}
+
+void calibrationReset()
+{
+	calibration.magic = calibrationMagic;
+	calibration.version = calibrationVersion;
+	calibration.keys = calibrationKeys;
+	for (int i{ 0 }; i < calibrationKeys; ++i) {
+		calibration.rests[i] = NAN;
+		calibration.tops[i] = NAN;
+		calibrationLast[i] = -1.0f;
+		calibrationStable[i] = 0;
+		calibrationUpdate(i);
+	}
+	calibrationDirty = false;
+}
+
+void calibrationLoad()
+{
+	calibrationReset();
+	FILE* file = NULL;
+	if (fopen_s(&file, "plugins/WAfAts.calibration", "rb") != 0 || file == NULL) {
+		log_line(SCS_LOG_TYPE_message, "no calibration yet, learning key travel as you drive");
+		return;
+	}
+	static calibration_file_t loaded;
+	bool good = fread(&loaded, sizeof(loaded), 1, file) == 1 && loaded.magic == calibrationMagic && loaded.version == calibrationVersion && loaded.keys == calibrationKeys;
+	fclose(file);
+	if (!good) {
+		log_line(SCS_LOG_TYPE_warning, "plugins/WAfAts.calibration is damaged or outdated, starting over");
+		return;
+	}
+	int calibrated = 0;
+	for (int i{ 0 }; i < calibrationKeys; ++i) {
+		//only trust what could have been learned, each end on its own
+		if (loaded.rests[i] >= 0.0f && loaded.rests[i] <= calibrationMaxRest) {
+			calibration.rests[i] = loaded.rests[i];
+		}
+		if (loaded.tops[i] >= calibrationMinTop && loaded.tops[i] <= 1.0f) {
+			calibration.tops[i] = loaded.tops[i];
+		}
+		calibrationUpdate(i);
+		calibrated += !std::isnan(calibration.rests[i]) || !std::isnan(calibration.tops[i]);
+	}
+	log_line(SCS_LOG_TYPE_message, "calibration loaded, %i keys learned", calibrated);
+}
+
+void calibrationSave()
+{
+	if (!calibrationDirty) {
+		return;
+	}
+	calibrationDirty = false;
+	//saved on the game thread while paused, so without stdio and its heap
+	if (!heapFreeWrite("plugins/WAfAts.calibration", "plugins/WAfAts.calibration.tmp", &calibration, sizeof(calibration))) {
+		log_line(SCS_LOG_TYPE_warning, "failure saving plugins/WAfAts.calibration");
+		return;
+	}
+	log_line(SCS_LOG_TYPE_message, "calibration saved");
+}
+
+float calibrationApply(unsigned short code, float value)
+{
+	if (code >= calibrationKeys) {
+		return value;
+	}
+	if (std::fabs(value - calibrationLast[code]) > calibrationStableBand) {
+		calibrationStable[code] = 0;
+	}
+	//only look at a value once, when it becomes stable
+	else if (calibrationStable[code] < calibrationStableSamples && ++calibrationStable[code] == calibrationStableSamples) {
+		//the first stable value near an end is taken, after that the rest only goes down and the top only up
+		//so a light touch or a press that stops short never narrows the range
+		bool resting = value >= 0.0f && value <= calibrationMaxRest && (std::isnan(calibration.rests[code]) || value < calibration.rests[code]);
+		bool toppedOut = value >= calibrationMinTop && value <= 1.0f && (std::isnan(calibration.tops[code]) || value > calibration.tops[code]);
+		if (resting) {
+			calibration.rests[code] = value;
+		}
+		if (toppedOut) {
+			calibration.tops[code] = value;
+		}
+		if (resting || toppedOut) {
+			calibrationUpdate(code);
+			calibrationDirty = true;
+		}
+	}
+	calibrationLast[code] = value;
+
+	float normalized = (value - calibrationOffsets[code]) * calibrationScales[code];
+	return normalized < 0.0f ? 0.0f : (normalized > 1.0f ? 1.0f : normalized);
+}
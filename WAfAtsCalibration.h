@@ -0,0 +1,19 @@
+/*
+* Per-key travel calibration, learns where every key rests and tops out and stretches that to 0 to 1
+*/
+#pragma once
+
+//learn and apply calibration, set from 'calibrate' in the cfg
+extern bool calibrationEnabled;
+
+//forget every key, calibrationLoad starts with this
+void calibrationReset();
+//load plugins/WAfAts.calibration if there is one
+void calibrationLoad();
+
+//write plugins/WAfAts.calibration if anything was learned since the last save
+//written to a temporary file and renamed over the old one so a crash never leaves half a file
+void calibrationSave();
+
+//learn from a raw key value and return it normalized to 0 to 1, game thread only
+float calibrationApply(unsigned short code, float value);
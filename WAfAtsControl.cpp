@@ -0,0 +1,233 @@
+/*
+* Local control endpoint for tuning while driving, a named pipe on windows and a unix domain socket elsewhere
+*/
+
+// Windows stuff.
+#ifdef _WIN32
+//PIPE_REJECT_REMOTE_CLIENTS needs vista
+#  define WINVER 0x0600
+#  define _WIN32_WINNT 0x0600
+#  include <windows.h>
+#endif
+
+#include "WAfAtsControl.h"
+
+#include <thread>
+
+#ifndef _WIN32
+#  include <errno.h>
+#  include <poll.h>
+#  include <sys/socket.h>
+#  include <sys/un.h>
+#  include <unistd.h>
+#endif
+
+#include "ScsSdk/include/scssdk.h"
+
+void log_line(const scs_log_type_t type, const char* const text, ...);
+
+//a client that never sends a line break doesn't get to grow the buffer forever
+const size_t controlMaxLine = 4096;
+
+control_handler_fn controlHandler = NULL;
+std::thread* controlThread = NULL;
+
+//run the handler on every complete line that came in, the replies are added to reply
+void controlLines(std::string& pending, const char* data, size_t size, std::string& reply)
+{
+	pending.append(data, size);
+	size_t end = pending.find('\n');
+	while (end != std::string::npos) {
+		std::string line = pending.substr(0, end);
+		pending.erase(0, end + 1);
+		if (!line.empty() && line.back() == '\r') {
+			line.pop_back();
+		}
+		reply += controlHandler(line);
+		end = pending.find('\n');
+	}
+	if (pending.size() > controlMaxLine) {
+		pending.clear();
+	}
+}
+
+#ifdef _WIN32
+
+//one pipe instance for the whole session, connected and disconnected for every client
+HANDLE controlPipe = INVALID_HANDLE_VALUE;
+HANDLE controlStopEvent = NULL;
+
+//wait for an overlapped operation that was started, false if it failed or the thread is stopping
+bool controlWait(OVERLAPPED& overlapped, DWORD& bytes)
+{
+	HANDLE events[2] = { overlapped.hEvent, controlStopEvent };
+	if (WaitForMultipleObjects(2, events, FALSE, INFINITE) != WAIT_OBJECT_0) {
+		CancelIo(controlPipe);
+		GetOverlappedResult(controlPipe, &overlapped, &bytes, TRUE);
+		return false;
+	}
+	return GetOverlappedResult(controlPipe, &overlapped, &bytes, FALSE) != 0;
+}
+
+void controlLoop()
+{
+	OVERLAPPED overlapped = {};
+	overlapped.hEvent = CreateEventA(NULL, TRUE, FALSE, NULL);
+	while (WaitForSingleObject(controlStopEvent, 0) != WAIT_OBJECT_0) {
+		DWORD bytes = 0;
+		bool connected = ConnectNamedPipe(controlPipe, &overlapped) != 0;
+		if (!connected) {
+			DWORD error = GetLastError();
+			connected = error == ERROR_PIPE_CONNECTED || (error == ERROR_IO_PENDING && controlWait(overlapped, bytes));
+		}
+		std::string pending;
+		char buffer[512];
+		while (connected) {
+			if (!ReadFile(controlPipe, buffer, sizeof(buffer), NULL, &overlapped) && GetLastError() != ERROR_IO_PENDING) {
+				break;
+			}
+			if (!controlWait(overlapped, bytes) || bytes == 0) {
+				break;
+			}
+			std::string reply;
+			controlLines(pending, buffer, bytes, reply);
+			if (reply.empty()) {
+				continue;
+			}
+			if (!WriteFile(controlPipe, reply.data(), DWORD(reply.size()), NULL, &overlapped) && GetLastError() != ERROR_IO_PENDING) {
+				break;
+			}
+			connected = controlWait(overlapped, bytes);
+		}
+		DisconnectNamedPipe(controlPipe);
+	}
+	CloseHandle(overlapped.hEvent);
+}
+
+bool controlStart(control_handler_fn handler)
+{
+	controlStop();
+	//local clients only, and only one of us, a second game or plugin copy gets an error instead of sharing the name
+	controlPipe = CreateNamedPipeA(CONTROL_PIPE_NAME, PIPE_ACCESS_DUPLEX | FILE_FLAG_OVERLAPPED | FILE_FLAG_FIRST_PIPE_INSTANCE,
+		PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS, 1, 4096, 4096, 0, NULL);
+	if (controlPipe == INVALID_HANDLE_VALUE) {
+		log_line(SCS_LOG_TYPE_warning, "failure creating control pipe %s, error %lu", CONTROL_PIPE_NAME, GetLastError());
+		return false;
+	}
+	controlStopEvent = CreateEventA(NULL, TRUE, FALSE, NULL);
+	controlHandler = handler;
+	controlThread = new std::thread(controlLoop);
+	log_line(SCS_LOG_TYPE_message, "listening for tuning on %s", CONTROL_PIPE_NAME);
+	return true;
+}
+
+void controlStop()
+{
+	if (controlThread == NULL) {
+		return;
+	}
+	SetEvent(controlStopEvent);
+	controlThread->join();
+	delete controlThread;
+	controlThread = NULL;
+	CloseHandle(controlStopEvent);
+	controlStopEvent = NULL;
+	CloseHandle(controlPipe);
+	controlPipe = INVALID_HANDLE_VALUE;
+}
+
+#else
+
+int controlListen = -1;
+//controlStop writes to it to wake the thread out of poll
+int controlWake[2] = { -1, -1 };
+
+//wait until fd has something to read, false if the thread is stopping
+bool controlWait(int fd)
+{
+	pollfd fds[2] = { { fd, POLLIN, 0 }, { controlWake[0], POLLIN, 0 } };
+	while (poll(fds, 2, -1) < 0) {
+		if (errno != EINTR) {
+			return false;
+		}
+	}
+	return fds[1].revents == 0;
+}
+
+void controlLoop()
+{
+	while (controlWait(controlListen)) {
+		int client = accept(controlListen, NULL, NULL);
+		if (client < 0) {
+			continue;
+		}
+		std::string pending;
+		char buffer[512];
+		while (controlWait(client)) {
+			ssize_t bytes = recv(client, buffer, sizeof(buffer), 0);
+			if (bytes <= 0) {
+				break;
+			}
+			std::string reply;
+			controlLines(pending, buffer, size_t(bytes), reply);
+			size_t sent = 0;
+			while (sent < reply.size()) {
+				ssize_t written = send(client, reply.data() + sent, reply.size() - sent, MSG_NOSIGNAL);
+				if (written <= 0) {
+					break;
+				}
+				sent += size_t(written);
+			}
+			if (sent < reply.size()) {
+				break;
+			}
+		}
+		close(client);
+	}
+}
+
+bool controlStart(control_handler_fn handler)
+{
+	controlStop();
+	sockaddr_un address = {};
+	address.sun_family = AF_UNIX;
+	strncpy(address.sun_path, CONTROL_SOCKET_PATH, sizeof(address.sun_path) - 1);
+	//a socket file left by a crashed game would make bind fail
+	unlink(CONTROL_SOCKET_PATH);
+	controlListen = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (controlListen < 0 || bind(controlListen, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(controlListen, 1) != 0 || pipe(controlWake) != 0) {
+		log_line(SCS_LOG_TYPE_warning, "failure creating control socket %s, error %i", CONTROL_SOCKET_PATH, errno);
+		if (controlListen >= 0) {
+			close(controlListen);
+			controlListen = -1;
+		}
+		return false;
+	}
+	controlHandler = handler;
+	controlThread = new std::thread(controlLoop);
+	log_line(SCS_LOG_TYPE_message, "listening for tuning on %s", CONTROL_SOCKET_PATH);
+	return true;
+}
+
+void controlStop()
+{
+	if (controlThread == NULL) {
+		return;
+	}
+	char wake = 0;
+	if (write(controlWake[1], &wake, 1) != 1) {
+		//nothing else could wake it, it is blocked in poll on the listening socket until a client comes
+		shutdown(controlListen, SHUT_RDWR);
+	}
+	controlThread->join();
+	delete controlThread;
+	controlThread = NULL;
+	close(controlListen);
+	close(controlWake[0]);
+	close(controlWake[1]);
+	controlListen = -1;
+	controlWake[0] = controlWake[1] = -1;
+	unlink(CONTROL_SOCKET_PATH);
+}
+
+#endif
@@ -0,0 +1,18 @@
+/*
+* Local control endpoint for tuning while driving, a named pipe on windows and a unix domain socket elsewhere
+* one client at a time sends lines and gets the handler's reply to each, all on a thread of its own
+*/
+#pragma once
+
+#include <string>
+
+#define CONTROL_PIPE_NAME "\\\\.\\pipe\\WAfAts"
+#define CONTROL_SOCKET_PATH "plugins/WAfAts.sock"
+
+//called on the control thread for every line without its line break, returns the reply, every line of it ends with '\n'
+typedef std::string (*control_handler_fn)(const std::string& line);
+
+//start listening, false if the endpoint couldn't be created
+bool controlStart(control_handler_fn handler);
+//disconnect the client and stop the thread
+void controlStop();
@@ -0,0 +1,318 @@
+/*
+* Staying off the heap while driving
+*/
+
+// Windows stuff.
+#ifdef _WIN32
+#  define WINVER 0x0500
+#  define _WIN32_WINNT 0x0500
+#  include <windows.h>
+#endif
+
+#include "WAfAtsHeap.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <new>
+
+#ifndef _WIN32
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+char* heapArena = NULL;
+size_t heapArenaBytes = 0;
+size_t heapArenaOffset = 0;
+
+bool heapArenaInit(size_t size)
+{
+	heapArenaRelease();
+	if (size == 0) {
+		return true;
+	}
+	heapArena = new (std::nothrow) char[size];
+	if (heapArena == NULL) {
+		return false;
+	}
+	heapArenaBytes = size;
+	return true;
+}
+
+void* heapArenaAlloc(size_t size, size_t alignment)
+{
+	if (heapArena == NULL) {
+		return NULL;
+	}
+	uintptr_t base = reinterpret_cast<uintptr_t>(heapArena);
+	uintptr_t address = (base + heapArenaOffset + alignment - 1) & ~uintptr_t(alignment - 1);
+	if (address + size > base + heapArenaBytes) {
+		return NULL;
+	}
+	heapArenaOffset = address + size - base;
+	return reinterpret_cast<void*>(address);
+}
+
+size_t heapArenaSize()
+{
+	return heapArenaBytes;
+}
+
+size_t heapArenaUsed()
+{
+	return heapArenaOffset;
+}
+
+void heapArenaRelease()
+{
+	delete[] heapArena;
+	heapArena = NULL;
+	heapArenaBytes = 0;
+	heapArenaOffset = 0;
+}
+
+bool heapFreeWrite(const char* path, const char* temporary, const void* data, size_t size)
+{
+	const char* target = temporary != NULL ? temporary : path;
+#ifdef _WIN32
+	HANDLE file = CreateFileA(target, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	DWORD written = 0;
+	bool ok = WriteFile(file, data, DWORD(size), &written, NULL) && written == size;
+	ok = CloseHandle(file) && ok;
+	if (temporary != NULL) {
+		ok = ok && MoveFileExA(temporary, path, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+	}
+#else
+	int file = open(target, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (file < 0) {
+		return false;
+	}
+	size_t written = 0;
+	while (written < size) {
+		ssize_t bytes = write(file, static_cast<const char*>(data) + written, size - written);
+		if (bytes <= 0) {
+			break;
+		}
+		written += size_t(bytes);
+	}
+	bool ok = written == size;
+	ok = close(file) == 0 && ok;
+	if (temporary != NULL) {
+		ok = ok && rename(temporary, path) == 0;
+	}
+#endif
+	return ok;
+}
+
+#ifdef _WIN32
+
+bool mapFile(const char* path, mapped_file_t& mapped)
+{
+	//the game may still be writing it
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	mapped.file = file;
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+		return false;
+	}
+	mapped.size = (unsigned long long)size.QuadPart;
+	mapped.mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapped.mapping == NULL) {
+		return false;
+	}
+	mapped.data = static_cast<const unsigned char*>(MapViewOfFile(mapped.mapping, FILE_MAP_READ, 0, 0, 0));
+	return mapped.data != NULL;
+}
+
+void unmapFile(mapped_file_t& mapped)
+{
+	if (mapped.data != NULL) {
+		UnmapViewOfFile(mapped.data);
+	}
+	if (mapped.mapping != NULL) {
+		CloseHandle(mapped.mapping);
+	}
+	if (mapped.file != NULL) {
+		CloseHandle(mapped.file);
+	}
+	mapped = mapped_file_t();
+}
+
+#else
+
+bool mapFile(const char* path, mapped_file_t& mapped)
+{
+	mapped.descriptor = open(path, O_RDONLY);
+	if (mapped.descriptor < 0) {
+		return false;
+	}
+	struct stat info;
+	if (fstat(mapped.descriptor, &info) != 0 || info.st_size == 0) {
+		return false;
+	}
+	mapped.size = (unsigned long long)info.st_size;
+	void* data = mmap(NULL, mapped.size, PROT_READ, MAP_PRIVATE, mapped.descriptor, 0);
+	if (data == MAP_FAILED) {
+		return false;
+	}
+	madvise(data, mapped.size, MADV_SEQUENTIAL);
+	mapped.data = static_cast<const unsigned char*>(data);
+	return true;
+}
+
+void unmapFile(mapped_file_t& mapped)
+{
+	if (mapped.data != NULL) {
+		munmap(const_cast<unsigned char*>(mapped.data), mapped.size);
+	}
+	if (mapped.descriptor >= 0) {
+		close(mapped.descriptor);
+	}
+	mapped = mapped_file_t();
+}
+
+#endif
+
+
+#ifdef WAFATS_ALLOC_CHECK
+
+#if defined(_WIN32) && !defined(_DEBUG)
+#  error "WAFATS_ALLOC_CHECK needs a Debug build on windows, the allocation hook is part of the debug crt"
+#endif
+#if !defined(_WIN32) && !defined(__GLIBC__)
+#  error "WAFATS_ALLOC_CHECK needs the debug crt on windows or glibc elsewhere"
+#endif
+
+#ifdef _WIN32
+#  include <crtdbg.h>
+#else
+#  include <errno.h>
+#endif
+
+#define UNUSED(x)
+
+std::atomic<bool> heapCheckArmed{ false };
+std::atomic<unsigned long long> heapCheckAllocations{ 0 };
+//checked scopes the thread is in, initial exec so reading it inside malloc never needs malloc to set up the thread's tls
+#ifdef __GLIBC__
+thread_local int heapCheckDepth __attribute__((tls_model("initial-exec"))) = 0;
+#else
+thread_local int heapCheckDepth = 0;
+#endif
+
+inline void heapCheckAllocation()
+{
+	if (heapCheckArmed.load(std::memory_order_relaxed) && heapCheckDepth > 0) {
+		heapCheckAllocations.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+#ifdef _WIN32
+
+//the debug crt calls it for every malloc, new and stdio buffer of every module using the debug crt
+int heapCheckHook(int allocType, void* UNUSED(data), size_t UNUSED(size), int UNUSED(blockType), long UNUSED(request), const unsigned char* UNUSED(file), int UNUSED(line))
+{
+	if (allocType == _HOOK_ALLOC || allocType == _HOOK_REALLOC) {
+		heapCheckAllocation();
+	}
+	return TRUE;
+}
+
+#else
+
+//the executable's malloc wins over the one in libc, so this sees every allocation of the analyzer and the bench
+//a plugin loaded by the game resolves malloc to libc before it gets here, check it in a windows debug build
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* block, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+
+void* malloc(size_t size)
+{
+	heapCheckAllocation();
+	return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size)
+{
+	heapCheckAllocation();
+	return __libc_calloc(count, size);
+}
+
+void* realloc(void* block, size_t size)
+{
+	heapCheckAllocation();
+	return __libc_realloc(block, size);
+}
+
+void* memalign(size_t alignment, size_t size)
+{
+	heapCheckAllocation();
+	return __libc_memalign(alignment, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size)
+{
+	heapCheckAllocation();
+	return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void** block, size_t alignment, size_t size)
+{
+	heapCheckAllocation();
+	*block = __libc_memalign(alignment, size);
+	return *block != NULL ? 0 : ENOMEM;
+}
+}
+
+#endif
+
+void heapCheckArm()
+{
+#ifdef _WIN32
+	_CrtSetAllocHook(heapCheckHook);
+#endif
+	heapCheckAllocations.store(0, std::memory_order_relaxed);
+	heapCheckArmed.store(true, std::memory_order_release);
+}
+
+void heapCheckDisarm()
+{
+	heapCheckArmed.store(false, std::memory_order_release);
+}
+
+unsigned long long heapCheckCount()
+{
+	return heapCheckAllocations.load(std::memory_order_relaxed);
+}
+
+heap_check_t::heap_check_t()
+{
+	++heapCheckDepth;
+}
+
+heap_check_t::~heap_check_t()
+{
+	--heapCheckDepth;
+}
+
+heap_check_pause_t::heap_check_pause_t() : depth(heapCheckDepth)
+{
+	heapCheckDepth = 0;
+}
+
+heap_check_pause_t::~heap_check_pause_t()
+{
+	heapCheckDepth = depth;
+}
+
+#endif
@@ -0,0 +1,74 @@
+/*
+* Staying off the heap while driving
+* buffers whose size depends on the cfg come from one arena allocated at init, files are mapped and written without stdio
+* builds with WAFATS_ALLOC_CHECK defined count every heap allocation made inside the input callback after init
+*/
+#pragma once
+
+#include <cstddef>
+
+//free the last arena and allocate size bytes for heapArenaAlloc, false if that failed
+bool heapArenaInit(size_t size);
+//carve a block out of the arena, NULL if it wasn't sized for it
+void* heapArenaAlloc(size_t size, size_t alignment);
+//the arena's size and how much of it is handed out
+size_t heapArenaSize();
+size_t heapArenaUsed();
+//everything handed out is gone, call when nothing uses it anymore
+void heapArenaRelease();
+
+//write size bytes to path through the os, stdio allocates its FILE and buffer on the heap
+//with a temporary the data goes there first and is renamed over path so a crash never leaves half a file
+bool heapFreeWrite(const char* path, const char* temporary, const void* data, size_t size);
+
+//a read only view of a whole file, pages are only read in as they are touched
+struct mapped_file_t
+{
+	const unsigned char* data = NULL;
+	unsigned long long size = 0;
+	//the file and mapping HANDLEs on windows
+	void* file = NULL;
+	void* mapping = NULL;
+	//the file descriptor elsewhere
+	int descriptor = -1;
+};
+
+//false if the file is missing or empty, call unmapFile either way
+bool mapFile(const char* path, mapped_file_t& mapped);
+void unmapFile(mapped_file_t& mapped);
+
+#ifdef WAFATS_ALLOC_CHECK
+
+//start counting, call once init is done
+void heapCheckArm();
+void heapCheckDisarm();
+//heap allocations inside checked scopes since heapCheckArm
+unsigned long long heapCheckCount();
+
+//allocations of the calling thread count while it is inside the scope
+struct heap_check_t
+{
+	heap_check_t();
+	~heap_check_t();
+};
+
+//allocations of the calling thread don't count while it is inside the scope, for calls into the game
+struct heap_check_pause_t
+{
+	int depth;
+
+	heap_check_pause_t();
+	~heap_check_pause_t();
+};
+
+#define HEAP_CONCAT2(a, b) a##b
+#define HEAP_CONCAT(a, b) HEAP_CONCAT2(a, b)
+#define HEAP_CHECK() heap_check_t HEAP_CONCAT(heapCheck, __LINE__)
+#define HEAP_CHECK_PAUSE() heap_check_pause_t HEAP_CONCAT(heapCheckPause, __LINE__)
+
+#else
+
+#define HEAP_CHECK()
+#define HEAP_CHECK_PAUSE()
+
+#endif
@@ -0,0 +1,291 @@
+/*
+* Frame kernel, turns the key values of a frame into the output of every axis and a bitmask of the axes that changed
+* one lane per axis in packed arrays, with sse2 and avx2 versions picked at runtime next to the scalar reference
+*/
+
+#include "WAfAtsKernel.h"
+
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#  define KERNEL_X86
+#  include <immintrin.h>
+#  ifdef _MSC_VER
+#    include <intrin.h>
+//msvc takes any intrinsic, gcc and clang need functions using avx2 marked
+#    define KERNEL_AVX2
+#    define KERNEL_SSE2
+#  else
+#    define KERNEL_AVX2 __attribute__((target("avx2")))
+#    define KERNEL_SSE2 __attribute__((target("sse2")))
+#  endif
+#endif
+
+//the outputs depend on the exact order of every float operation, the simd versions do the same operations in the same order
+unsigned int frameKernelScalar(frame_kernel_t& kernel, const float* keys)
+{
+	unsigned int changed = 0;
+	for (int i{ 0 }; i < kernelLanes; ++i) {
+		float left = keys[kernel.leftKeys[i]];
+		float right = keys[kernel.rightKeys[i]];
+		float value = left == right ? 0.0f : (left > right ? -left : right);
+		if (kernel.derivedLanes[i]) {
+			value = kernel.derived[i];
+		}
+		float outside = std::fabs(value) - kernel.deadzones[i];
+		outside = outside > 0.0f ? outside * kernel.deadzoneScales[i] : 0.0f;
+		value = value < 0.0f ? -outside : outside;
+		if (kernel.shapedLanes[i] && value != 0.0f) {
+			//travel past the end of the table gets the last entry
+			float travel = std::fabs(value);
+			travel = travel < 1.0f ? travel : 1.0f;
+			float position = travel * float(responseTableSize - 1);
+			int index = int(position);
+			int next = index < responseTableSize - 1 ? index + 1 : index;
+			float fraction = position - float(index);
+			const float* low = kernel.tables + kernel.lowTables[i];
+			const float* high = kernel.tables + kernel.highTables[i];
+			float lowOutput = low[index] + (low[next] - low[index]) * fraction;
+			float highOutput = high[index] + (high[next] - high[index]) * fraction;
+			float output = lowOutput + (highOutput - lowOutput) * kernel.blends[i];
+			value = value < 0.0f ? -output : output;
+		}
+		kernel.outputs[i] = value;
+		if (value != kernel.lastReported[i]) {
+			changed |= 1u << i;
+		}
+	}
+	return changed;
+}
+
+#ifdef KERNEL_X86
+
+//4 lanes at a time, there is no gather before avx2 so the key and table loads stay scalar
+KERNEL_SSE2 unsigned int frameKernelSse2(frame_kernel_t& kernel, const float* keys)
+{
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 sign = _mm_set1_ps(-0.0f);
+	const __m128 lastPosition = _mm_set1_ps(float(responseTableSize - 1));
+	const __m128i lastIndex = _mm_set1_epi32(responseTableSize - 1);
+	const __m128i oneIndex = _mm_set1_epi32(1);
+	unsigned int changed = 0;
+	for (int base{ 0 }; base < kernelLanes; base += 4) {
+		const int* leftKeys = kernel.leftKeys + base;
+		const int* rightKeys = kernel.rightKeys + base;
+		__m128 left = _mm_setr_ps(keys[leftKeys[0]], keys[leftKeys[1]], keys[leftKeys[2]], keys[leftKeys[3]]);
+		__m128 right = _mm_setr_ps(keys[rightKeys[0]], keys[rightKeys[1]], keys[rightKeys[2]], keys[rightKeys[3]]);
+		__m128 greater = _mm_cmpgt_ps(left, right);
+		__m128 value = _mm_or_ps(_mm_and_ps(greater, _mm_xor_ps(left, sign)), _mm_andnot_ps(greater, right));
+		value = _mm_andnot_ps(_mm_cmpeq_ps(left, right), value);
+		__m128 derived = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(kernel.derivedLanes + base)));
+		value = _mm_or_ps(_mm_and_ps(derived, _mm_loadu_ps(kernel.derived + base)), _mm_andnot_ps(derived, value));
+		__m128 outside = _mm_max_ps(_mm_sub_ps(_mm_andnot_ps(sign, value), _mm_loadu_ps(kernel.deadzones + base)), zero);
+		outside = _mm_mul_ps(outside, _mm_loadu_ps(kernel.deadzoneScales + base));
+		value = _mm_xor_ps(outside, _mm_and_ps(_mm_cmplt_ps(value, zero), sign));
+
+		__m128 shaped = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(kernel.shapedLanes + base)));
+		shaped = _mm_and_ps(shaped, _mm_cmpneq_ps(value, zero));
+		if (_mm_movemask_ps(shaped) != 0) {
+			__m128 travel = _mm_min_ps(_mm_andnot_ps(sign, value), one);
+			__m128 position = _mm_mul_ps(travel, lastPosition);
+			__m128i index = _mm_cvttps_epi32(position);
+			__m128i next = _mm_add_epi32(index, _mm_andnot_si128(_mm_cmpeq_epi32(index, lastIndex), oneIndex));
+			__m128 fraction = _mm_sub_ps(position, _mm_cvtepi32_ps(index));
+			alignas(16) int indices[4];
+			alignas(16) int nexts[4];
+			_mm_store_si128(reinterpret_cast<__m128i*>(indices), index);
+			_mm_store_si128(reinterpret_cast<__m128i*>(nexts), next);
+			alignas(16) float lows[4];
+			alignas(16) float lowNexts[4];
+			alignas(16) float highs[4];
+			alignas(16) float highNexts[4];
+			for (int j{ 0 }; j < 4; ++j) {
+				const float* low = kernel.tables + kernel.lowTables[base + j];
+				const float* high = kernel.tables + kernel.highTables[base + j];
+				lows[j] = low[indices[j]];
+				lowNexts[j] = low[nexts[j]];
+				highs[j] = high[indices[j]];
+				highNexts[j] = high[nexts[j]];
+			}
+			__m128 low = _mm_load_ps(lows);
+			__m128 high = _mm_load_ps(highs);
+			__m128 lowOutput = _mm_add_ps(low, _mm_mul_ps(_mm_sub_ps(_mm_load_ps(lowNexts), low), fraction));
+			__m128 highOutput = _mm_add_ps(high, _mm_mul_ps(_mm_sub_ps(_mm_load_ps(highNexts), high), fraction));
+			__m128 output = _mm_add_ps(lowOutput, _mm_mul_ps(_mm_sub_ps(highOutput, lowOutput), _mm_loadu_ps(kernel.blends + base)));
+			output = _mm_xor_ps(output, _mm_and_ps(_mm_cmplt_ps(value, zero), sign));
+			value = _mm_or_ps(_mm_and_ps(shaped, output), _mm_andnot_ps(shaped, value));
+		}
+		_mm_storeu_ps(kernel.outputs + base, value);
+		changed |= unsigned(_mm_movemask_ps(_mm_cmpneq_ps(value, _mm_loadu_ps(kernel.lastReported + base)))) << base;
+	}
+	return changed;
+}
+
+//all 8 lanes at once with gathers for the keys and tables
+KERNEL_AVX2 unsigned int frameKernelAvx2(frame_kernel_t& kernel, const float* keys)
+{
+	static_assert(kernelLanes == 8, "the avx2 kernel does all lanes in one register");
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 sign = _mm256_set1_ps(-0.0f);
+	const __m256 lastPosition = _mm256_set1_ps(float(responseTableSize - 1));
+	const __m256i lastIndex = _mm256_set1_epi32(responseTableSize - 1);
+	const __m256i oneIndex = _mm256_set1_epi32(1);
+
+	__m256 left = _mm256_i32gather_ps(keys, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(kernel.leftKeys)), 4);
+	__m256 right = _mm256_i32gather_ps(keys, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(kernel.rightKeys)), 4);
+	__m256 value = _mm256_blendv_ps(right, _mm256_xor_ps(left, sign), _mm256_cmp_ps(left, right, _CMP_GT_OQ));
+	value = _mm256_andnot_ps(_mm256_cmp_ps(left, right, _CMP_EQ_OQ), value);
+	__m256 derived = _mm256_castsi256_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(kernel.derivedLanes)));
+	value = _mm256_blendv_ps(value, _mm256_loadu_ps(kernel.derived), derived);
+	__m256 outside = _mm256_max_ps(_mm256_sub_ps(_mm256_andnot_ps(sign, value), _mm256_loadu_ps(kernel.deadzones)), zero);
+	outside = _mm256_mul_ps(outside, _mm256_loadu_ps(kernel.deadzoneScales));
+	value = _mm256_xor_ps(outside, _mm256_and_ps(_mm256_cmp_ps(value, zero, _CMP_LT_OQ), sign));
+
+	__m256 shaped = _mm256_castsi256_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(kernel.shapedLanes)));
+	shaped = _mm256_and_ps(shaped, _mm256_cmp_ps(value, zero, _CMP_NEQ_UQ));
+	if (_mm256_movemask_ps(shaped) != 0) {
+		__m256 travel = _mm256_min_ps(_mm256_andnot_ps(sign, value), one);
+		__m256 position = _mm256_mul_ps(travel, lastPosition);
+		__m256i index = _mm256_cvttps_epi32(position);
+		__m256i next = _mm256_add_epi32(index, _mm256_andnot_si256(_mm256_cmpeq_epi32(index, lastIndex), oneIndex));
+		__m256 fraction = _mm256_sub_ps(position, _mm256_cvtepi32_ps(index));
+		__m256i lowTables = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(kernel.lowTables));
+		__m256i highTables = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(kernel.highTables));
+		__m256 low = _mm256_i32gather_ps(kernel.tables, _mm256_add_epi32(lowTables, index), 4);
+		__m256 lowNext = _mm256_i32gather_ps(kernel.tables, _mm256_add_epi32(lowTables, next), 4);
+		__m256 high = _mm256_i32gather_ps(kernel.tables, _mm256_add_epi32(highTables, index), 4);
+		__m256 highNext = _mm256_i32gather_ps(kernel.tables, _mm256_add_epi32(highTables, next), 4);
+		__m256 lowOutput = _mm256_add_ps(low, _mm256_mul_ps(_mm256_sub_ps(lowNext, low), fraction));
+		__m256 highOutput = _mm256_add_ps(high, _mm256_mul_ps(_mm256_sub_ps(highNext, high), fraction));
+		__m256 output = _mm256_add_ps(lowOutput, _mm256_mul_ps(_mm256_sub_ps(highOutput, lowOutput), _mm256_loadu_ps(kernel.blends)));
+		output = _mm256_xor_ps(output, _mm256_and_ps(_mm256_cmp_ps(value, zero, _CMP_LT_OQ), sign));
+		value = _mm256_blendv_ps(value, output, shaped);
+	}
+	_mm256_storeu_ps(kernel.outputs, value);
+	return unsigned(_mm256_movemask_ps(_mm256_cmp_ps(value, _mm256_loadu_ps(kernel.lastReported), _CMP_NEQ_UQ)));
+}
+
+#endif
+
+frameKernelLevel detectFrameKernel()
+{
+#ifdef KERNEL_X86
+#  ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+	int maxLeaf = info[0];
+	__cpuid(info, 1);
+	bool sse2 = (info[3] & (1 << 26)) != 0;
+	//avx registers also need saving by the os
+	bool avx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6;
+	bool avx2 = false;
+	if (avx && maxLeaf >= 7) {
+		__cpuidex(info, 7, 0);
+		avx2 = (info[1] & (1 << 5)) != 0;
+	}
+#  else
+	__builtin_cpu_init();
+	bool sse2 = __builtin_cpu_supports("sse2");
+	bool avx2 = __builtin_cpu_supports("avx2");
+#  endif
+	if (avx2) {
+		return kernel_avx2;
+	}
+	if (sse2) {
+		return kernel_sse2;
+	}
+#endif
+	return kernel_scalar;
+}
+
+frame_kernel_fn frameKernelOf(frameKernelLevel level)
+{
+	if (level == kernel_scalar) {
+		return frameKernelScalar;
+	}
+#ifdef KERNEL_X86
+	if (level > detectFrameKernel()) {
+		return NULL;
+	}
+	if (level == kernel_sse2) {
+		return frameKernelSse2;
+	}
+	if (level == kernel_avx2) {
+		return frameKernelAvx2;
+	}
+#endif
+	return NULL;
+}
+
+const char* frameKernelName(frameKernelLevel level)
+{
+	switch (level) {
+	case kernel_sse2: return "sse2";
+	case kernel_avx2: return "avx2";
+	default: return "scalar";
+	}
+}
+
+
+//xorshift, the check has to see the same frames on every machine
+unsigned int kernelRandom(unsigned int& state)
+{
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+//0 to 1 in 1/256 steps so equal keys and exact table hits come up often
+float kernelRandomUnit(unsigned int& state)
+{
+	return float(kernelRandom(state) % 257) / 256.0f;
+}
+
+int checkFrameKernel(frame_kernel_fn kernel, unsigned int seed, int frames)
+{
+	//the last key stays 0 like the one single and disabled axes point at
+	const int checkKeys = 16;
+	float keys[checkKeys] = {};
+	frame_kernel_t reference;
+	frame_kernel_t tested;
+	unsigned int state = seed != 0 ? seed : 1;
+	for (float& entry : reference.tables) {
+		entry = kernelRandomUnit(state) * 1.5f;
+	}
+	int mismatches = 0;
+	for (int frame{ 0 }; frame < frames; ++frame) {
+		for (int k{ 0 }; k < checkKeys - 1; ++k) {
+			//mostly steps of 1/256, sometimes any float and sometimes the same as the key before
+			unsigned int pick = kernelRandom(state) % 8;
+			keys[k] = pick == 0 && k > 0 ? keys[k - 1] : pick == 1 ? float(kernelRandom(state)) / 4294967296.0f : kernelRandomUnit(state);
+		}
+		for (int i{ 0 }; i < kernelLanes; ++i) {
+			reference.leftKeys[i] = int(kernelRandom(state) % checkKeys);
+			reference.rightKeys[i] = int(kernelRandom(state) % checkKeys);
+			reference.derivedLanes[i] = kernelRandom(state) % 4 == 0 ? -1 : 0;
+			reference.derived[i] = kernelRandom(state) % 4 == 0 ? 0.0f : (kernelRandomUnit(state) - 0.5f) * 3.0f;
+			//no deadzone on half the lanes, a deadzone on a 1/256 step of travel now and then so keys land right on its edge
+			float deadzone = kernelRandom(state) % 2 == 0 ? 0.0f : kernelRandomUnit(state) * 0.5f;
+			reference.deadzones[i] = deadzone;
+			reference.deadzoneScales[i] = 1.0f / (1.0f - deadzone);
+			reference.shapedLanes[i] = kernelRandom(state) % 4 != 0 ? -1 : 0;
+			reference.lowTables[i] = (i * maxSpeedBands + int(kernelRandom(state) % maxSpeedBands)) * responseTableSize;
+			reference.highTables[i] = (i * maxSpeedBands + int(kernelRandom(state) % maxSpeedBands)) * responseTableSize;
+			reference.blends[i] = kernelRandomUnit(state);
+			//unchanged from the last frame, never reported (NAN after a resync) or anything else
+			unsigned int last = kernelRandom(state) % 8;
+			reference.lastReported[i] = last < 4 ? reference.outputs[i] : last == 4 ? NAN : kernelRandomUnit(state);
+		}
+		tested = reference;
+		unsigned int expected = frameKernelScalar(reference, keys);
+		unsigned int result = kernel(tested, keys);
+		if (result != expected || memcmp(reference.outputs, tested.outputs, sizeof(reference.outputs)) != 0) {
+			++mismatches;
+		}
+	}
+	return mismatches;
+}
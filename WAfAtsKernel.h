@@ -0,0 +1,64 @@
+/*
+* Frame kernel, turns the key values of a frame into the output of every axis and a bitmask of the axes that changed
+* one lane per axis in packed arrays, with sse2 and avx2 versions picked at runtime next to the scalar reference
+*/
+#pragma once
+
+//lanes of the kernel, every game axis gets one and the rest stay idle
+const int kernelLanes = 8;
+
+//speed response tables, see speed_response_t
+const int maxSpeedBands = 4;
+const int responseTableSize = 33;
+
+//state of every lane, built from the cfg at load and refreshed at the start of a frame
+struct frame_kernel_t
+{
+	//lane i combines keys[leftKeys[i]] and keys[rightKeys[i]] like calculateSharedAxis,
+	//single axes have their key on the right and single and disabled axes point at a key that stays 0
+	int leftKeys[kernelLanes] = {};
+	int rightKeys[kernelLanes] = {};
+	//all bits set for lanes reporting derived[] instead of their keys, derived and predicted axes
+	int derivedLanes[kernelLanes] = {};
+	//travel inside the deadzone gives 0, what is left is multiplied by the scale so it still reaches 1
+	float deadzones[kernelLanes] = {};
+	float deadzoneScales[kernelLanes] = { 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f };
+	//all bits set for lanes with a speed response
+	int shapedLanes[kernelLanes] = {};
+	//every speed response table, band b of lane i starts at (i * maxSpeedBands + b) * responseTableSize
+	float tables[kernelLanes * maxSpeedBands * responseTableSize] = {};
+
+	//per frame: start of the tables of the bands around the current speed and how far between them it is
+	int lowTables[kernelLanes] = {};
+	int highTables[kernelLanes] = {};
+	float blends[kernelLanes] = {};
+	float derived[kernelLanes] = {};
+	float lastReported[kernelLanes] = {};
+
+	//written by the kernel
+	float outputs[kernelLanes] = {};
+};
+
+//returns the bits of the lanes whose output differs from lastReported
+typedef unsigned int (*frame_kernel_fn)(frame_kernel_t& kernel, const float* keys);
+
+enum frameKernelLevel {
+	kernel_scalar,
+	kernel_sse2,
+	kernel_avx2,
+};
+
+//reference version, the others have to match it bit for bit
+unsigned int frameKernelScalar(frame_kernel_t& kernel, const float* keys);
+
+//best version the cpu and the build support
+frameKernelLevel detectFrameKernel();
+
+//kernel of a level, NULL if this build or cpu can't run it
+frame_kernel_fn frameKernelOf(frameKernelLevel level);
+
+const char* frameKernelName(frameKernelLevel level);
+
+//run a kernel and the scalar reference on random frames from a fixed seed, WAfAtsAnalyzer --check runs it for every level
+//returns the number of frames where the outputs or the mask differ in any bit
+int checkFrameKernel(frame_kernel_fn kernel, unsigned int seed, int frames);
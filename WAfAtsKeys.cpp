@@ -0,0 +1,242 @@
+/*
+* Key names for the cfg, resolved to usb hid codes through a perfect hash built at compile time
+*/
+
+#include "WAfAtsKeys.h"
+
+
+struct key_name_t
+{
+	const char* name;
+	unsigned short code;
+	//the same key as scan code set 1 (0xe0xx for extended keys) and us layout windows virtual key, 0 = none
+	unsigned short scanCode1;
+	unsigned char virtualKey;
+};
+
+//names may only use letters, digits, '-' and '_' so they survive the cfg whitelist
+constexpr key_name_t keyNames[] = {
+	{ "A", 4, 0x1E, 0x41 }, { "B", 5, 0x30, 0x42 }, { "C", 6, 0x2E, 0x43 }, { "D", 7, 0x20, 0x44 },
+	{ "E", 8, 0x12, 0x45 }, { "F", 9, 0x21, 0x46 }, { "G", 10, 0x22, 0x47 }, { "H", 11, 0x23, 0x48 },
+	{ "I", 12, 0x17, 0x49 }, { "J", 13, 0x24, 0x4A }, { "K", 14, 0x25, 0x4B }, { "L", 15, 0x26, 0x4C },
+	{ "M", 16, 0x32, 0x4D }, { "N", 17, 0x31, 0x4E }, { "O", 18, 0x18, 0x4F }, { "P", 19, 0x19, 0x50 },
+	{ "Q", 20, 0x10, 0x51 }, { "R", 21, 0x13, 0x52 }, { "S", 22, 0x1F, 0x53 }, { "T", 23, 0x14, 0x54 },
+	{ "U", 24, 0x16, 0x55 }, { "V", 25, 0x2F, 0x56 }, { "W", 26, 0x11, 0x57 }, { "X", 27, 0x2D, 0x58 },
+	{ "Y", 28, 0x15, 0x59 }, { "Z", 29, 0x2C, 0x5A },
+	//plain digits are hid codes
+	{ "Digit1", 30, 0x02, 0x31 }, { "Digit2", 31, 0x03, 0x32 }, { "Digit3", 32, 0x04, 0x33 }, { "Digit4", 33, 0x05, 0x34 },
+	{ "Digit5", 34, 0x06, 0x35 }, { "Digit6", 35, 0x07, 0x36 }, { "Digit7", 36, 0x08, 0x37 }, { "Digit8", 37, 0x09, 0x38 },
+	{ "Digit9", 38, 0x0A, 0x39 }, { "Digit0", 39, 0x0B, 0x30 },
+	{ "Enter", 40, 0x1C, 0x0D }, { "Esc", 41, 0x01, 0x1B }, { "Backspace", 42, 0x0E, 0x08 }, { "Tab", 43, 0x0F, 0x09 },
+	{ "Space", 44, 0x39, 0x20 }, { "Minus", 45, 0x0C, 0xBD }, { "Equals", 46, 0x0D, 0xBB }, { "LBracket", 47, 0x1A, 0xDB },
+	{ "RBracket", 48, 0x1B, 0xDD }, { "Backslash", 49, 0x2B, 0xDC }, { "NonUS-1", 50, 0x00, 0x00 }, { "Semicolon", 51, 0x27, 0xBA },
+	{ "Quote", 52, 0x28, 0xDE }, { "Grave", 53, 0x29, 0xC0 }, { "Comma", 54, 0x33, 0xBC }, { "Period", 55, 0x34, 0xBE },
+	{ "Slash", 56, 0x35, 0xBF }, { "CapsLock", 57, 0x3A, 0x14 }, { "F1", 58, 0x3B, 0x70 }, { "F2", 59, 0x3C, 0x71 },
+	{ "F3", 60, 0x3D, 0x72 }, { "F4", 61, 0x3E, 0x73 }, { "F5", 62, 0x3F, 0x74 }, { "F6", 63, 0x40, 0x75 },
+	{ "F7", 64, 0x41, 0x76 }, { "F8", 65, 0x42, 0x77 }, { "F9", 66, 0x43, 0x78 }, { "F10", 67, 0x44, 0x79 },
+	{ "F11", 68, 0x57, 0x7A }, { "F12", 69, 0x58, 0x7B }, { "PrtScr", 70, 0xE037, 0x2C }, { "ScrollLock", 71, 0x46, 0x91 },
+	{ "Pause", 72, 0x00, 0x13 }, { "Insert", 73, 0xE052, 0x2D }, { "Home", 74, 0xE047, 0x24 }, { "PgUp", 75, 0xE049, 0x21 },
+	{ "Delete", 76, 0xE053, 0x2E }, { "End", 77, 0xE04F, 0x23 }, { "PgDn", 78, 0xE051, 0x22 }, { "Right", 79, 0xE04D, 0x27 },
+	{ "Left", 80, 0xE04B, 0x25 }, { "Down", 81, 0xE050, 0x28 }, { "Up", 82, 0xE048, 0x26 }, { "NumLock", 83, 0x45, 0x90 },
+	{ "KP-Slash", 84, 0xE035, 0x6F }, { "KP-Star", 85, 0x37, 0x6A }, { "KP-Minus", 86, 0x4A, 0x6D }, { "KP-Plus", 87, 0x4E, 0x6B },
+	{ "KP-Enter", 88, 0xE01C, 0x00 }, { "KP-1", 89, 0x4F, 0x61 }, { "KP-2", 90, 0x50, 0x62 }, { "KP-3", 91, 0x51, 0x63 },
+	{ "KP-4", 92, 0x4B, 0x64 }, { "KP-5", 93, 0x4C, 0x65 }, { "KP-6", 94, 0x4D, 0x66 }, { "KP-7", 95, 0x47, 0x67 },
+	{ "KP-8", 96, 0x48, 0x68 }, { "KP-9", 97, 0x49, 0x69 }, { "KP-0", 98, 0x52, 0x60 }, { "KP-Period", 99, 0x53, 0x6E },
+	{ "SysRq", 154, 0x54, 0x00 }, { "LCtrl", 224, 0x1D, 0xA2 }, { "LShift", 225, 0x2A, 0xA0 }, { "LAlt", 226, 0x38, 0xA4 },
+	{ "LWin", 227, 0xE05B, 0x5B }, { "RCtrl", 228, 0xE01D, 0xA3 }, { "RShift", 229, 0x36, 0xA1 }, { "RAlt", 230, 0xE038, 0xA5 },
+	{ "RWin", 231, 0xE05C, 0x5C },
+};
+
+constexpr int keyNameCount = sizeof(keyNames) / sizeof(keyNames[0]);
+
+constexpr char lowerCase(char c)
+{
+	return c >= 'A' && c <= 'Z' ? char(c - 'A' + 'a') : c;
+}
+
+//case insensitive fnv-1a, the seed picks a different function from the same family
+constexpr unsigned int hashKeyName(const char* name, unsigned int length, unsigned int seed)
+{
+	unsigned int hash = 2166136261u ^ (seed * 0x9e3779b9u);
+	for (unsigned int i{ 0 }; i < length; ++i) {
+		hash = (hash ^ (unsigned char)lowerCase(name[i])) * 16777619u;
+	}
+	return hash ^ (hash >> 15);
+}
+
+constexpr unsigned int nameLength(const char* name)
+{
+	unsigned int length = 0;
+	while (name[length] != 0) {
+		++length;
+	}
+	return length;
+}
+
+//hash and displace: the first hash picks a bucket, each bucket has its own seed for the second hash
+//that puts all of its names in free slots, so a lookup is two hashes and one compare
+const int keyHashBuckets = 64;
+const int keyHashSlots = 256;
+
+struct key_hash_table_t
+{
+	bool complete = false;
+	unsigned short seeds[keyHashBuckets] = {};
+	//index into keyNames, -1 = empty
+	short slots[keyHashSlots] = {};
+};
+
+constexpr key_hash_table_t buildKeyHashTable()
+{
+	key_hash_table_t table;
+	for (int s{ 0 }; s < keyHashSlots; ++s) {
+		table.slots[s] = -1;
+	}
+	int bucketSize[keyHashBuckets] = {};
+	for (int k{ 0 }; k < keyNameCount; ++k) {
+		++bucketSize[hashKeyName(keyNames[k].name, nameLength(keyNames[k].name), 0) % keyHashBuckets];
+	}
+	//biggest buckets first while the table is still empty
+	for (int size{ keyNameCount }; size > 0; --size) {
+		for (int b{ 0 }; b < keyHashBuckets; ++b) {
+			if (bucketSize[b] != size) {
+				continue;
+			}
+			bool placed = false;
+			for (unsigned int seed{ 1 }; seed < 65536 && !placed; ++seed) {
+				short taken[keyHashSlots] = {};
+				placed = true;
+				for (int k{ 0 }; k < keyNameCount && placed; ++k) {
+					unsigned int length = nameLength(keyNames[k].name);
+					if (hashKeyName(keyNames[k].name, length, 0) % keyHashBuckets != unsigned(b)) {
+						continue;
+					}
+					unsigned int slot = hashKeyName(keyNames[k].name, length, seed) % keyHashSlots;
+					if (table.slots[slot] >= 0 || taken[slot]) {
+						placed = false;
+					}
+					taken[slot] = 1;
+				}
+				if (placed) {
+					table.seeds[b] = (unsigned short)seed;
+					for (int k{ 0 }; k < keyNameCount; ++k) {
+						unsigned int length = nameLength(keyNames[k].name);
+						if (hashKeyName(keyNames[k].name, length, 0) % keyHashBuckets == unsigned(b)) {
+							table.slots[hashKeyName(keyNames[k].name, length, seed) % keyHashSlots] = short(k);
+						}
+					}
+				}
+			}
+			if (!placed) {
+				return table;
+			}
+		}
+	}
+	table.complete = true;
+	return table;
+}
+
+constexpr key_hash_table_t keyHashTable = buildKeyHashTable();
+static_assert(keyHashTable.complete, "no perfect hash found for keyNames, change keyHashSlots");
+
+bool sameKeyName(const char* a, const std::string& b)
+{
+	size_t i = 0;
+	for (; i < b.size() && a[i] != 0; ++i) {
+		if (lowerCase(a[i]) != lowerCase(b[i])) {
+			return false;
+		}
+	}
+	return i == b.size() && a[i] == 0;
+}
+
+int keyCodeFromName(const std::string& name)
+{
+	unsigned int length = (unsigned int)name.size();
+	unsigned int bucket = hashKeyName(name.c_str(), length, 0) % keyHashBuckets;
+	int k = keyHashTable.slots[hashKeyName(name.c_str(), length, keyHashTable.seeds[bucket]) % keyHashSlots];
+	if (k < 0 || !sameKeyName(keyNames[k].name, name)) {
+		return -1;
+	}
+	return keyNames[k].code;
+}
+
+//case insensitive edit distance, only used for error messages
+int keyNameDistance(const char* a, const std::string& b)
+{
+	const int maxLength = 32;
+	int previous[maxLength + 1];
+	int current[maxLength + 1];
+	int lengthB = b.size() < maxLength ? int(b.size()) : maxLength;
+	for (int j{ 0 }; j <= lengthB; ++j) {
+		previous[j] = j;
+	}
+	for (int i{ 0 }; a[i] != 0; ++i) {
+		current[0] = i + 1;
+		for (int j{ 0 }; j < lengthB; ++j) {
+			int substitute = previous[j] + (lowerCase(a[i]) == lowerCase(b[j]) ? 0 : 1);
+			int remove = previous[j + 1] + 1;
+			int insert = current[j] + 1;
+			int best = substitute < remove ? substitute : remove;
+			current[j + 1] = best < insert ? best : insert;
+		}
+		for (int j{ 0 }; j <= lengthB; ++j) {
+			previous[j] = current[j];
+		}
+	}
+	return previous[lengthB];
+}
+
+const char* nearestKeyName(const std::string& name)
+{
+	const char* nearest = keyNames[0].name;
+	int nearestDistance = keyNameDistance(nearest, name);
+	for (int k{ 1 }; k < keyNameCount; ++k) {
+		int distance = keyNameDistance(keyNames[k].name, name);
+		if (distance < nearestDistance) {
+			nearest = keyNames[k].name;
+			nearestDistance = distance;
+		}
+	}
+	return nearest;
+}
+
+const char* keyNameFromCode(int code)
+{
+	for (int k{ 0 }; k < keyNameCount; ++k) {
+		if (keyNames[k].code == code) {
+			return keyNames[k].name;
+		}
+	}
+	return NULL;
+}
+
+int hidFromScanCode1(int scanCode)
+{
+	for (int k{ 0 }; k < keyNameCount; ++k) {
+		if (scanCode != 0 && keyNames[k].scanCode1 == scanCode) {
+			return keyNames[k].code;
+		}
+	}
+	return 0;
+}
+
+int hidFromVirtualKey(int virtualKey)
+{
+	for (int k{ 0 }; k < keyNameCount; ++k) {
+		if (virtualKey != 0 && keyNames[k].virtualKey == virtualKey) {
+			return keyNames[k].code;
+		}
+	}
+	return 0;
+}
+
+int virtualKeyFromHid(int code)
+{
+	for (int k{ 0 }; k < keyNameCount; ++k) {
+		if (keyNames[k].code == code) {
+			return keyNames[k].virtualKey;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,22 @@
+/*
+* Key names for the cfg, resolved to usb hid codes through a perfect hash built at compile time
+*/
+#pragma once
+
+#include <string>
+
+//hid code of a key name like 'W', 'LShift', 'KP-8' or 'Up', case doesn't matter
+//returns -1 if there is no key with that name
+int keyCodeFromName(const std::string& name);
+
+//the valid key name closest to a mistyped one
+const char* nearestKeyName(const std::string& name);
+
+//name of a hid code, NULL if it has none
+const char* keyNameFromCode(int code);
+
+//physical hid code of a key in the other wooting keycode modes, 0 if the key is unknown
+//virtual keys are on the standard us layout here, layout translation is up to the caller
+int hidFromScanCode1(int scanCode);
+int hidFromVirtualKey(int virtualKey);
+int virtualKeyFromHid(int code);
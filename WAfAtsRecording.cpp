@@ -0,0 +1,120 @@
+/*
+* Session recordings, the key values of every frame as the plugin sampled them
+*/
+
+#include "WAfAtsRecording.h"
+#include "WAfAtsHeap.h"
+
+#include <cstdio>
+#include <cstring>
+
+#include "ScsSdk/include/scssdk.h"
+
+void log_line(const scs_log_type_t type, const char* const text, ...);
+
+bool recordingEnabled = false;
+
+FILE* recordingFile = NULL;
+recording_frame_t* recordingBlock = NULL;
+int recordingBuffered = 0;
+int recordingKeys = 0;
+unsigned long long recordingFrames = 0;
+
+bool recordingStart(const char* path, const unsigned short* codes, int count, bool calibrated)
+{
+	recordingStop();
+	if (count > recordingMaxKeys) {
+		count = recordingMaxKeys;
+	}
+	recordingBlock = static_cast<recording_frame_t*>(heapArenaAlloc(recordingArenaBytes, alignof(recording_frame_t)));
+	if (recordingBlock == NULL) {
+		log_line(SCS_LOG_TYPE_warning, "no room for the recording buffer, not recording");
+		return false;
+	}
+	if (fopen_s(&recordingFile, path, "wb") != 0 || recordingFile == NULL) {
+		recordingFile = NULL;
+		log_line(SCS_LOG_TYPE_warning, "failure writing %s, not recording", path);
+		return false;
+	}
+	//we write whole blocks anyway, a stdio buffer would only be another allocation on the first write
+	setvbuf(recordingFile, NULL, _IONBF, 0);
+	recording_header_t header = {};
+	header.magic = recordingMagic;
+	header.version = recordingVersion;
+	header.frameSize = sizeof(recording_frame_t);
+	header.keyCount = (unsigned int)count;
+	memcpy(header.codes, codes, count * sizeof(unsigned short));
+	header.calibrated = calibrated ? 1 : 0;
+	if (fwrite(&header, sizeof(header), 1, recordingFile) != 1) {
+		log_line(SCS_LOG_TYPE_warning, "failure writing %s, not recording", path);
+		fclose(recordingFile);
+		recordingFile = NULL;
+		return false;
+	}
+	recordingBuffered = 0;
+	recordingKeys = count;
+	recordingFrames = 0;
+	recordingEnabled = true;
+	log_line(SCS_LOG_TYPE_message, "recording %i keys to %s", count, path);
+	return true;
+}
+
+void recordingFrame(long long time, float speed, unsigned int flags, const float* values)
+{
+	recording_frame_t& frame = recordingBlock[recordingBuffered];
+	frame.time = time;
+	frame.speed = speed;
+	frame.flags = flags;
+	memcpy(frame.values, values, recordingKeys * sizeof(float));
+	memset(frame.values + recordingKeys, 0, (recordingMaxKeys - recordingKeys) * sizeof(float));
+	if (++recordingBuffered == recordingBlockFrames) {
+		recordingFlush();
+	}
+}
+
+void recordingSegment(long long time, const unsigned short* codes, int count)
+{
+	if (count > recordingMaxKeys) {
+		count = recordingMaxKeys;
+	}
+	float values[recordingMaxKeys];
+	for (int k{ 0 }; k < count; ++k) {
+		values[k] = float(codes[k]);
+	}
+	recordingKeys = count;
+	recordingFrame(time, float(count), recording_frame_segment, values);
+	log_line(SCS_LOG_TYPE_message, "recording %i other keys from frame %llu on", count, recordingFrames + recordingBuffered);
+}
+
+void recordingFlush()
+{
+	if (recordingFile == NULL || recordingBuffered == 0) {
+		return;
+	}
+	size_t count = size_t(recordingBuffered);
+	recordingBuffered = 0;
+	size_t written = fwrite(recordingBlock, sizeof(recording_frame_t), count, recordingFile);
+	recordingFrames += written;
+	//a full disk shouldn't cost a failing write every block for the rest of the session
+	if (written != count) {
+		log_line(SCS_LOG_TYPE_warning, "failure writing the recording, stopped after %llu frames", recordingFrames);
+		fclose(recordingFile);
+		recordingFile = NULL;
+		recordingEnabled = false;
+	}
+}
+
+void recordingStop()
+{
+	if (recordingFile == NULL) {
+		return;
+	}
+	recordingFlush();
+	if (recordingFile != NULL) {
+		fclose(recordingFile);
+		recordingFile = NULL;
+		log_line(SCS_LOG_TYPE_message, "recorded %llu frames", recordingFrames);
+	}
+	recordingEnabled = false;
+	recordingBlock = NULL;
+}
@@ -0,0 +1,63 @@
+/*
+* Session recordings, the key values of every frame as the plugin sampled them
+* written to plugins/WAfAts.rec with 'record = 1' in the cfg and replayed by Analyzer\WAfAtsAnalyzer
+*/
+#pragma once
+
+#include <cstddef>
+
+const unsigned int recordingMagic = 0x43455257;
+const unsigned int recordingVersion = 2;
+//the bound keys of every layer
+const int recordingMaxKeys = 32;
+//frames held before they are written, about 8 s at 60 fps so the game thread writes rarely and in big blocks
+const int recordingBlockFrames = 512;
+
+//first thing in the file, followed by one recording_frame_t per frame up to the end of the file
+struct recording_header_t
+{
+	unsigned int magic;
+	unsigned int version;
+	//sizeof(recording_frame_t) of the writer, frames are found by index so it has to match
+	unsigned int frameSize;
+	unsigned int keyCount;
+	//hid codes of the recorded keys, values[k] of every frame is codes[k] up to the first segment frame
+	unsigned short codes[recordingMaxKeys];
+	//1 if the values went through calibration
+	unsigned int calibrated;
+};
+
+//the frame came after a pause or the first call after activation, the time since the last frame is no frame time
+const unsigned int recording_frame_resync = 1;
+//the bound keys changed, with the keyboard layout, the frame has no sample and starts a segment
+//values[k] are the hid codes of values[k] in the frames after it and speed is how many keys there are, since version 2
+const unsigned int recording_frame_segment = 2;
+
+struct recording_frame_t
+{
+	//statsNow ns when the keys were sampled
+	long long time;
+	//telemetry speed in m/s, 0 without telemetry
+	float speed;
+	unsigned int flags;
+	float values[recordingMaxKeys];
+};
+
+static_assert(sizeof(recording_frame_t) % 8 == 0, "recorded frames have to stay aligned in a mapped file");
+
+//the block of buffered frames, taken from the arena when recording starts
+const size_t recordingArenaBytes = recordingBlockFrames * sizeof(recording_frame_t);
+
+
+//writer, game thread only
+
+extern bool recordingEnabled;
+
+//truncate path and write the header, frames are buffered until a block is full, needs recordingArenaBytes left in the arena
+bool recordingStart(const char* path, const unsigned short* codes, int count, bool calibrated);
+void recordingFrame(long long time, float speed, unsigned int flags, const float* values);
+//the frames after this one are of other keys
+void recordingSegment(long long time, const unsigned short* codes, int count);
+//write the buffered frames, call when file io doesn't hurt
+void recordingFlush();
+void recordingStop();
@@ -0,0 +1,195 @@
+/*
+* Scheduling of background sampling threads: cpu affinity, priority and waits for absolute deadlines
+* that don't round up to the 1 ms (linux) to 15.6 ms (windows) sleep granularity
+*/
+
+// Windows stuff.
+#ifdef _WIN32
+//high resolution waitable timers need the windows 10 api, only this file uses them
+#  define WINVER 0x0A00
+#  define _WIN32_WINNT 0x0A00
+#  include <windows.h>
+#endif
+
+#include "WAfAtsSampler.h"
+
+#include <cstring>
+
+#ifdef __linux__
+#  include <errno.h>
+#  include <pthread.h>
+#  include <sched.h>
+#  include <time.h>
+#endif
+
+#include "WAfAtsStats.h"
+
+#define UNUSED(x)
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#  define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+bool samplerParsePriority(const char* text, samplerPriority& priority)
+{
+	if (strcmp(text, "normal") == 0) {
+		priority = sampler_priority_normal;
+	}
+	else if (strcmp(text, "above") == 0) {
+		priority = sampler_priority_above;
+	}
+	else if (strcmp(text, "high") == 0) {
+		priority = sampler_priority_high;
+	}
+	else if (strcmp(text, "realtime") == 0) {
+		priority = sampler_priority_realtime;
+	}
+	else {
+		return false;
+	}
+	return true;
+}
+
+#ifdef _WIN32
+
+bool samplerApply(const sampler_settings_t& settings, std::thread* thread)
+{
+	HANDLE handle = thread != NULL ? HANDLE(thread->native_handle()) : GetCurrentThread();
+	bool applied = true;
+	if (settings.affinity != 0) {
+		applied = SetThreadAffinityMask(handle, DWORD_PTR(settings.affinity)) != 0 && applied;
+	}
+	const int priorities[] = { THREAD_PRIORITY_NORMAL, THREAD_PRIORITY_ABOVE_NORMAL, THREAD_PRIORITY_HIGHEST, THREAD_PRIORITY_TIME_CRITICAL };
+	applied = SetThreadPriority(handle, priorities[settings.priority]) != 0 && applied;
+	return applied;
+}
+
+bool samplerTimerOpen(sampler_timer_t& timer, int spinUs)
+{
+	timer.spinNs = spinUs * 1000LL;
+	//windows 10 1803 and later, older ones only get the normal timer that wakes on the next tick
+	timer.handle = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+	if (timer.handle != NULL) {
+		return true;
+	}
+	timer.handle = CreateWaitableTimerExW(NULL, NULL, 0, TIMER_ALL_ACCESS);
+	return false;
+}
+
+void samplerTimerClose(sampler_timer_t& timer)
+{
+	if (timer.handle != NULL) {
+		CloseHandle(timer.handle);
+		timer.handle = NULL;
+	}
+}
+
+//waitable timers only take relative or wall clock times, so the absolute deadline is turned into a relative one here
+void samplerSleepUntil(sampler_timer_t& UNUSED(timer), long long deadline)
+{
+	long long remaining = deadline - statsNow();
+	if (remaining <= 0) {
+		return;
+	}
+	if (timer.handle == NULL) {
+		Sleep(DWORD(remaining / 1000000));
+		return;
+	}
+	LARGE_INTEGER due;
+	due.QuadPart = -(remaining / 100);
+	if (SetWaitableTimer(timer.handle, &due, 0, NULL, NULL, FALSE)) {
+		WaitForSingleObject(timer.handle, INFINITE);
+	}
+}
+
+#elif defined(__linux__)
+
+bool samplerApply(const sampler_settings_t& settings, std::thread* thread)
+{
+	pthread_t handle = thread != NULL ? thread->native_handle() : pthread_self();
+	bool applied = true;
+	if (settings.affinity != 0) {
+		cpu_set_t cpus;
+		CPU_ZERO(&cpus);
+		for (int cpu{ 0 }; cpu < 64; ++cpu) {
+			if (settings.affinity & (1ull << cpu)) {
+				CPU_SET(cpu, &cpus);
+			}
+		}
+		applied = pthread_setaffinity_np(handle, sizeof(cpus), &cpus) == 0 && applied;
+	}
+	//nice values are per thread id, which another thread's pthread_t doesn't give, so anything above normal is a realtime policy
+	sched_param param = {};
+	int policy = SCHED_OTHER;
+	if (settings.priority == sampler_priority_above || settings.priority == sampler_priority_high) {
+		policy = SCHED_RR;
+		int low = sched_get_priority_min(SCHED_RR);
+		param.sched_priority = settings.priority == sampler_priority_above ? low : (low + sched_get_priority_max(SCHED_RR)) / 2;
+	}
+	else if (settings.priority == sampler_priority_realtime) {
+		policy = SCHED_FIFO;
+		param.sched_priority = sched_get_priority_max(SCHED_FIFO) - 1;
+	}
+	applied = pthread_setschedparam(handle, policy, &param) == 0 && applied;
+	return applied;
+}
+
+bool samplerTimerOpen(sampler_timer_t& timer, int spinUs)
+{
+	//clock_nanosleep needs no handle, statsNow is steady_clock which is CLOCK_MONOTONIC
+	timer.spinNs = spinUs * 1000LL;
+	return true;
+}
+
+void samplerTimerClose(sampler_timer_t& timer)
+{
+	timer.handle = NULL;
+}
+
+void samplerSleepUntil(sampler_timer_t& UNUSED(timer), long long deadline)
+{
+	timespec until;
+	until.tv_sec = time_t(deadline / 1000000000);
+	until.tv_nsec = long(deadline % 1000000000);
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, NULL) == EINTR) {
+	}
+}
+
+#else
+
+bool samplerApply(const sampler_settings_t& settings, std::thread* UNUSED(thread))
+{
+	return settings.affinity == 0 && settings.priority == sampler_priority_normal;
+}
+
+bool samplerTimerOpen(sampler_timer_t& timer, int spinUs)
+{
+	timer.spinNs = spinUs * 1000LL;
+	return false;
+}
+
+void samplerTimerClose(sampler_timer_t& timer)
+{
+	timer.handle = NULL;
+}
+
+void samplerSleepUntil(sampler_timer_t& UNUSED(timer), long long deadline)
+{
+	long long remaining = deadline - statsNow();
+	if (remaining > 0) {
+		std::this_thread::sleep_for(std::chrono::nanoseconds(remaining));
+	}
+}
+
+#endif
+
+long long samplerWaitUntil(sampler_timer_t& timer, long long deadline)
+{
+	samplerSleepUntil(timer, deadline - timer.spinNs);
+	long long now = statsNow();
+	while (now < deadline) {
+		std::this_thread::yield();
+		now = statsNow();
+	}
+	return now - deadline;
+}
@@ -0,0 +1,44 @@
+/*
+* Scheduling of background sampling threads: cpu affinity, priority and waits for absolute deadlines
+* that don't round up to the 1 ms (linux) to 15.6 ms (windows) sleep granularity
+*/
+#pragma once
+
+#include <thread>
+
+enum samplerPriority {
+	sampler_priority_normal,
+	sampler_priority_above,
+	sampler_priority_high,
+	//windows time critical, linux SCHED_FIFO, a busy sampler at this level can starve the game
+	sampler_priority_realtime,
+};
+
+struct sampler_settings_t
+{
+	//bit per logical cpu the thread may run on, 0 = any
+	unsigned long long affinity = 0;
+	samplerPriority priority = sampler_priority_normal;
+};
+
+//'normal', 'above', 'high' or 'realtime'
+bool samplerParsePriority(const char* text, samplerPriority& priority);
+
+//apply affinity and priority to thread, or the calling thread if it is NULL
+//false if the os refused any of it, linux needs CAP_SYS_NICE for anything above normal
+bool samplerApply(const sampler_settings_t& settings, std::thread* thread = NULL);
+
+//a high resolution timer for absolute deadlines on the statsNow clock
+struct sampler_timer_t
+{
+	void* handle = NULL;
+	//spin instead of sleeping for the last part of a wait, 0 = sleep the whole way
+	long long spinNs = 0;
+};
+
+//false if only a normal resolution timer was available, waits still work but wake later
+bool samplerTimerOpen(sampler_timer_t& timer, int spinUs);
+void samplerTimerClose(sampler_timer_t& timer);
+
+//sleep, then spin, until deadline, returns how far from the deadline it woke in ns
+long long samplerWaitUntil(sampler_timer_t& timer, long long deadline);
@@ -0,0 +1,353 @@
+/*
+* Always-on counters and latency histograms for the input path
+*/
+
+#include "WAfAtsStats.h"
+#include "WAfAtsHeap.h"
+
+#include <atomic>
+#include <cstdarg>
+#include <cstdio>
+#include <memory>
+
+#include "ScsSdk/include/scssdk.h"
+#include "WootingSdkWrapper/includes/wooting-analog-wrapper.h"
+
+void log_line(const scs_log_type_t type, const char* const text, ...);
+
+//log-linear buckets like HdrHistogram, 8 sub-buckets per power of two keeps every bucket within 12.5%
+//values up to 2^40 (about 18 minutes in ns), bigger ones land in the last bucket
+const int statsSubBucketBits = 3;
+const int statsSubBuckets = 1 << statsSubBucketBits;
+const int statsBuckets = (40 - statsSubBucketBits) * statsSubBuckets + 2 * statsSubBuckets;
+
+//WootingAnalogResult errors run from -2000 (UnInitialized) to -1990 (DLLNotFound)
+const int statsFirstSdkError = WootingAnalogResult_UnInitialized;
+const int statsSdkErrors = WootingAnalogResult_DLLNotFound - WootingAnalogResult_UnInitialized + 2;
+
+const char* statsCounterNames[stat_counter_count] = { "frames", "events", "suppressed", "sdk reads", "sdk timeouts", "reconnects", "layer switches" };
+const char* statsHistogramNames[stat_histogram_count] = { "frame time ns", "sample to event ns", "sdk reads per frame",
+	"prediction error 1e-4", "unpredicted error 1e-4",
+	"sampler jitter ns" };
+const char* statsSdkErrorNames[statsSdkErrors] = { "UnInitialized", "NoDevices", "DeviceDisconnected", "Failure", "InvalidArgument",
+	"NoPlugins", "FunctionNotFound", "NoMapping", "NotAvailable", "IncompatibleVersion", "DLLNotFound", "other" };
+
+//only the owning thread writes a slot, so a relaxed load and store is enough and never locks the bus
+//except the overflow slot, the threads sharing it add with fetch_add
+struct alignas(64) stats_slot_t
+{
+	std::atomic<unsigned long long> counters[stat_counter_count];
+	std::atomic<unsigned long long> sdkErrors[statsSdkErrors];
+	std::atomic<unsigned long long> histograms[stat_histogram_count][statsBuckets];
+	std::atomic<unsigned long long> maximums[stat_histogram_count];
+};
+
+//game thread, sdk worker, sampler and control thread own a slot each, anything beyond that shares the last one
+const int statsOwnedSlots = 4;
+const int statsMaxThreads = statsOwnedSlots + 1;
+stats_slot_t statsSlots[statsMaxThreads];
+std::atomic<int> statsSlotsClaimed{ 0 };
+thread_local int statsThreadSlot = -1;
+
+long long statsSummaryNs = 0;
+long long statsNextSummary = 0;
+bool statsExportFile = false;
+
+//the export is formatted here and written in one go, from the arena when exporting with every summary
+//every bucket of every histogram with room to spare, the counters and sdk errors are a few lines more
+const size_t statsExportBytes = size_t(stat_histogram_count) * (statsBuckets + 4) * 48 + size_t(stat_counter_count + statsSdkErrors) * 64;
+char* statsExportText = NULL;
+
+stats_slot_t& statsSlot()
+{
+	if (statsThreadSlot < 0) {
+		int slot = statsSlotsClaimed.fetch_add(1, std::memory_order_relaxed);
+		statsThreadSlot = slot < statsOwnedSlots ? slot : statsOwnedSlots;
+	}
+	return statsSlots[statsThreadSlot];
+}
+
+inline bool statsSharedSlot()
+{
+	return statsThreadSlot == statsOwnedSlots;
+}
+
+inline void statsBump(std::atomic<unsigned long long>& value, unsigned long long amount)
+{
+	if (statsSharedSlot()) {
+		value.fetch_add(amount, std::memory_order_relaxed);
+	}
+	else {
+		value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+	}
+}
+
+inline void statsRaise(std::atomic<unsigned long long>& maximum, unsigned long long value)
+{
+	unsigned long long current = maximum.load(std::memory_order_relaxed);
+	if (!statsSharedSlot()) {
+		if (value > current) {
+			maximum.store(value, std::memory_order_relaxed);
+		}
+		return;
+	}
+	while (value > current && !maximum.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+	}
+}
+
+int statsHighestBit(unsigned long long value)
+{
+	int bit = 0;
+	while (value >>= 1) {
+		++bit;
+	}
+	return bit;
+}
+
+int statsBucket(unsigned long long value)
+{
+	if (value < statsSubBuckets) {
+		return int(value);
+	}
+	int shift = statsHighestBit(value) - statsSubBucketBits;
+	int bucket = shift * statsSubBuckets + int(value >> shift);
+	return bucket < statsBuckets ? bucket : statsBuckets - 1;
+}
+
+unsigned long long statsBucketLow(int bucket)
+{
+	if (bucket < 2 * statsSubBuckets) {
+		return bucket;
+	}
+	int shift = bucket / statsSubBuckets - 1;
+	return (unsigned long long)(bucket % statsSubBuckets + statsSubBuckets) << shift;
+}
+
+void statsInit(int summaryS, bool exportFile)
+{
+	for (int s{ 0 }; s < statsMaxThreads; ++s) {
+		for (auto& counter : statsSlots[s].counters) { counter.store(0, std::memory_order_relaxed); }
+		for (auto& error : statsSlots[s].sdkErrors) { error.store(0, std::memory_order_relaxed); }
+		for (auto& histogram : statsSlots[s].histograms) {
+			for (auto& bucket : histogram) { bucket.store(0, std::memory_order_relaxed); }
+		}
+		for (auto& maximum : statsSlots[s].maximums) { maximum.store(0, std::memory_order_relaxed); }
+	}
+	statsSummaryNs = summaryS * 1000000000LL;
+	//started by the first frame, so summaries follow the frame clock, replays reach them on recorded time
+	statsNextSummary = 0;
+	statsExportText = exportFile ? static_cast<char*>(heapArenaAlloc(statsExportBytes, 1)) : NULL;
+	if (exportFile && statsExportText == NULL) {
+		log_line(SCS_LOG_TYPE_warning, "no room for the stats export, not exporting");
+	}
+	statsExportFile = statsExportText != NULL;
+}
+
+size_t statsArenaBytes(bool exportFile)
+{
+	return exportFile ? statsExportBytes : 0;
+}
+
+void statsAdd(statCounter counter, unsigned long long amount)
+{
+	statsBump(statsSlot().counters[counter], amount);
+}
+
+void statsRecord(statHistogram histogram, long long value)
+{
+	unsigned long long positive = value > 0 ? (unsigned long long)value : 0;
+	stats_slot_t& slot = statsSlot();
+	statsBump(slot.histograms[histogram][statsBucket(positive)], 1);
+	statsRaise(slot.maximums[histogram], positive);
+}
+
+void statsSdkError(int code)
+{
+	int index = code - statsFirstSdkError;
+	if (index < 0 || index >= statsSdkErrors - 1) {
+		index = statsSdkErrors - 1;
+	}
+	statsBump(statsSlot().sdkErrors[index], 1);
+}
+
+//sums of all slots
+struct stats_snapshot_t
+{
+	unsigned long long counters[stat_counter_count] = {};
+	unsigned long long sdkErrors[statsSdkErrors] = {};
+	unsigned long long histograms[stat_histogram_count][statsBuckets] = {};
+	unsigned long long maximums[stat_histogram_count] = {};
+	unsigned long long samples[stat_histogram_count] = {};
+};
+
+void statsTakeSnapshot(stats_snapshot_t& snapshot)
+{
+	int slots = statsSlotsClaimed.load(std::memory_order_relaxed);
+	for (int s{ 0 }; s < slots && s < statsMaxThreads; ++s) {
+		for (int c{ 0 }; c < stat_counter_count; ++c) {
+			snapshot.counters[c] += statsSlots[s].counters[c].load(std::memory_order_relaxed);
+		}
+		for (int e{ 0 }; e < statsSdkErrors; ++e) {
+			snapshot.sdkErrors[e] += statsSlots[s].sdkErrors[e].load(std::memory_order_relaxed);
+		}
+		for (int h{ 0 }; h < stat_histogram_count; ++h) {
+			for (int b{ 0 }; b < statsBuckets; ++b) {
+				unsigned long long count = statsSlots[s].histograms[h][b].load(std::memory_order_relaxed);
+				snapshot.histograms[h][b] += count;
+				snapshot.samples[h] += count;
+			}
+			unsigned long long maximum = statsSlots[s].maximums[h].load(std::memory_order_relaxed);
+			if (maximum > snapshot.maximums[h]) {
+				snapshot.maximums[h] = maximum;
+			}
+		}
+	}
+}
+
+//lower bound of the bucket holding the given fraction of samples
+unsigned long long statsPercentile(const stats_snapshot_t& snapshot, int histogram, double fraction)
+{
+	unsigned long long wanted = (unsigned long long)(snapshot.samples[histogram] * fraction);
+	unsigned long long seen = 0;
+	for (int b{ 0 }; b < statsBuckets; ++b) {
+		seen += snapshot.histograms[histogram][b];
+		if (seen > wanted) {
+			return statsBucketLow(b);
+		}
+	}
+	return snapshot.maximums[histogram];
+}
+
+//every line of a summary, the same for the game log and the control pipe
+void statsFormatSummary(const stats_snapshot_t& snapshot, void (*emit)(const char* line, void* context), void* context)
+{
+	char line[400];
+	snprintf(line, sizeof(line), "stats: frames = %llu, events = %llu, suppressed = %llu, sdk reads = %llu, sdk timeouts = %llu, reconnects = %llu, layer switches = %llu",
+		snapshot.counters[stat_frames], snapshot.counters[stat_events], snapshot.counters[stat_suppressed],
+		snapshot.counters[stat_sdk_reads], snapshot.counters[stat_sdk_timeouts], snapshot.counters[stat_reconnects],
+		snapshot.counters[stat_layer_switches]);
+	emit(line, context);
+	for (int h{ 0 }; h < stat_histogram_count; ++h) {
+		if (snapshot.samples[h] > 0) {
+			snprintf(line, sizeof(line), "stats: %s p50 = %llu, p99 = %llu, max = %llu", statsHistogramNames[h],
+				statsPercentile(snapshot, h, 0.5), statsPercentile(snapshot, h, 0.99), snapshot.maximums[h]);
+			emit(line, context);
+		}
+	}
+	for (int e{ 0 }; e < statsSdkErrors; ++e) {
+		if (snapshot.sdkErrors[e] > 0) {
+			snprintf(line, sizeof(line), "stats: sdk error %s = %llu", statsSdkErrorNames[e], snapshot.sdkErrors[e]);
+			emit(line, context);
+		}
+	}
+}
+
+void statsLogSummary()
+{
+	//too big for the stack of the game thread
+	static stats_snapshot_t snapshot;
+	snapshot = stats_snapshot_t();
+	statsTakeSnapshot(snapshot);
+	statsFormatSummary(snapshot, [](const char* line, void*) { log_line(SCS_LOG_TYPE_message, "%s", line); }, NULL);
+}
+
+std::string statsSummaryText()
+{
+	//its own snapshot, the static one belongs to the game thread
+	std::unique_ptr<stats_snapshot_t> snapshot(new stats_snapshot_t());
+	statsTakeSnapshot(*snapshot);
+	std::string text;
+	statsFormatSummary(*snapshot, [](const char* line, void* context) { *static_cast<std::string*>(context) += line; *static_cast<std::string*>(context) += '\n'; }, &text);
+	return text;
+}
+
+//add to export text of statsExportBytes, whatever doesn't fit is cut
+void statsAppend(char* text, size_t& length, const char* format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	int added = vsnprintf(text + length, statsExportBytes - length, format, args);
+	va_end(args);
+	if (added > 0) {
+		length = length + size_t(added) < statsExportBytes ? length + size_t(added) : statsExportBytes - 1;
+	}
+}
+
+//every counter and histogram bucket into text of statsExportBytes, returns the length
+size_t statsFormatExport(const stats_snapshot_t& snapshot, char* text)
+{
+	size_t length = 0;
+	for (int c{ 0 }; c < stat_counter_count; ++c) {
+		statsAppend(text, length, "%s = %llu\n", statsCounterNames[c], snapshot.counters[c]);
+	}
+	for (int e{ 0 }; e < statsSdkErrors; ++e) {
+		statsAppend(text, length, "sdk error %s = %llu\n", statsSdkErrorNames[e], snapshot.sdkErrors[e]);
+	}
+	for (int h{ 0 }; h < stat_histogram_count; ++h) {
+		statsAppend(text, length, "\n%s: samples = %llu, p50 = %llu, p90 = %llu, p99 = %llu, p99.9 = %llu, max = %llu\n", statsHistogramNames[h], snapshot.samples[h],
+			statsPercentile(snapshot, h, 0.5), statsPercentile(snapshot, h, 0.9), statsPercentile(snapshot, h, 0.99), statsPercentile(snapshot, h, 0.999), snapshot.maximums[h]);
+		//bucket lower bound, count
+		for (int b{ 0 }; b < statsBuckets; ++b) {
+			if (snapshot.histograms[h][b] > 0) {
+				statsAppend(text, length, "%llu, %llu\n", statsBucketLow(b), snapshot.histograms[h][b]);
+			}
+		}
+	}
+	return length;
+}
+
+bool statsExport(const char* path)
+{
+	if (statsExportText == NULL) {
+		return false;
+	}
+	static stats_snapshot_t snapshot;
+	snapshot = stats_snapshot_t();
+	statsTakeSnapshot(snapshot);
+	size_t length = statsFormatExport(snapshot, statsExportText);
+	//written from inside a frame, so without stdio and its heap
+	if (!heapFreeWrite(path, NULL, statsExportText, length)) {
+		log_line(SCS_LOG_TYPE_error, "failure writing stats file %s", path);
+		return false;
+	}
+	return true;
+}
+
+bool statsExportSnapshot(const char* path, const char* temporary)
+{
+	//its own snapshot and text, the static ones and the arena's belong to the game thread
+	std::unique_ptr<stats_snapshot_t> snapshot(new stats_snapshot_t());
+	statsTakeSnapshot(*snapshot);
+	std::unique_ptr<char[]> text(new char[statsExportBytes]);
+	size_t length = statsFormatExport(*snapshot, text.get());
+	return heapFreeWrite(path, temporary, text.get(), length);
+}
+
+void statsFrameEnd(long long now)
+{
+	if (statsSummaryNs == 0) {
+		return;
+	}
+	if (statsNextSummary == 0) {
+		statsNextSummary = now + statsSummaryNs;
+	}
+	if (now < statsNextSummary) {
+		return;
+	}
+	statsNextSummary = now + statsSummaryNs;
+	statsLogSummary();
+	if (statsExportFile) {
+		statsExport("plugins/WAfAts.stats.txt");
+	}
+}
+
+void statsShutdown()
+{
+	statsLogSummary();
+	if (statsExportFile) {
+		statsExport("plugins/WAfAts.stats.txt");
+	}
+	//the arena goes away after this
+	statsExportText = NULL;
+	statsExportFile = false;
+}
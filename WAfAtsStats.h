@@ -0,0 +1,61 @@
+/*
+* Always-on counters and latency histograms for the input path
+* every thread writes its own cache line padded slot, readers sum the slots
+*/
+#pragma once
+
+#include <chrono>
+#include <string>
+
+enum statCounter {
+	//frames from the first callback of a frame until the callback ran out of events
+	stat_frames,
+	stat_events,
+	//active axes that were evaluated in a frame but didn't change
+	stat_suppressed,
+	stat_sdk_reads,
+	stat_sdk_timeouts,
+	//successful read after the sdk reported no or disconnected devices
+	stat_reconnects,
+	//frames where a held modifier picked a different layer
+	stat_layer_switches,
+	stat_counter_count,
+};
+
+enum statHistogram {
+	//ns from the first callback of a frame until it returns SCS_RESULT_not_found
+	stat_frame_time,
+	//ns from reading the keys until the event built from them is handed to the game
+	stat_sample_to_event,
+	stat_sdk_reads_per_frame,
+	//1/10000 of travel between where a predicted axis was said to be and where it was, and the same without prediction
+	stat_prediction_error,
+	stat_unpredicted_error,
+	//ns a periodic sampler woke after its deadline
+	stat_sampler_jitter,
+	stat_histogram_count,
+};
+
+inline long long statsNow()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//clear everything, summaryS = seconds between summaries in the game log, 0 = only on shutdown
+//exporting takes statsArenaBytes from the arena for the text of the export
+void statsInit(int summaryS, bool exportFile);
+size_t statsArenaBytes(bool exportFile);
+void statsAdd(statCounter counter, unsigned long long amount = 1);
+void statsRecord(statHistogram histogram, long long value);
+//count a negative WootingAnalogResult returned by the sdk
+void statsSdkError(int code);
+//main thread, once per frame with the time the frame's keys were sampled at, logs the summary when it is due
+void statsFrameEnd(long long now);
+void statsLogSummary();
+//the lines of the summary, each ending with a line break, for any thread
+std::string statsSummaryText();
+//write every counter and histogram bucket to path, from the game thread with the text in the arena
+bool statsExport(const char* path);
+//the same on demand from any other thread, with its own text and through temporary, doesn't log
+bool statsExportSnapshot(const char* path, const char* temporary);
+void statsShutdown();
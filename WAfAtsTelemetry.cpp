@@ -0,0 +1,77 @@
+/*
+* Telemetry half of the plugin, feeds truck state to the input processing
+*/
+
+#include <cmath>
+
+#include "ScsSdk/include/scssdk_telemetry.h"
+
+#include "WAfAtsTelemetry.h"
+
+
+#define UNUSED(x)
+
+extern scs_log_t game_log;
+void log_line(const scs_log_type_t type, const char* const text, ...);
+
+//SCS_TELEMETRY_TRUCK_CHANNEL_speed from common/scssdk_telemetry_truck_common_channels.h, float in m/s, negative when reversing
+const char truckSpeedChannel[] = "truck.speed";
+
+std::atomic<float> telemetrySpeed{ 0.0f };
+//telemetry starts out paused
+std::atomic<bool> telemetryPaused{ true };
+std::atomic<bool> telemetryActive{ false };
+
+SCSAPI_VOID telemetry_speed_callback(const scs_string_t UNUSED(name), const scs_u32_t UNUSED(index), const scs_value_t* const value, const scs_context_t UNUSED(context))
+{
+	telemetrySpeed.store(value ? std::fabs(value->value_float.value) : 0.0f, std::memory_order_relaxed);
+}
+
+SCSAPI_VOID telemetry_pause_callback(const scs_event_t event, const void* const UNUSED(event_info), const scs_context_t UNUSED(context))
+{
+	telemetryPaused.store(event == SCS_TELEMETRY_EVENT_paused, std::memory_order_relaxed);
+}
+
+
+// Telemetry API initialization function.
+SCSAPI_RESULT scs_telemetry_init(const scs_u32_t version, const scs_telemetry_init_params_t* const params)
+{
+	if (version != SCS_TELEMETRY_VERSION_1_00 && version != SCS_TELEMETRY_VERSION_1_01) {
+		return SCS_RESULT_unsupported;
+	}
+
+	const scs_telemetry_init_params_v100_t* const version_params = static_cast<const scs_telemetry_init_params_v100_t*>(params);
+	//the order in which the game starts the input and telemetry api is undefined
+	if (!game_log) {
+		game_log = version_params->common.log;
+	}
+
+	const bool events_registered =
+		(version_params->register_for_event(SCS_TELEMETRY_EVENT_paused, telemetry_pause_callback, NULL) == SCS_RESULT_ok) &&
+		(version_params->register_for_event(SCS_TELEMETRY_EVENT_started, telemetry_pause_callback, NULL) == SCS_RESULT_ok);
+	if (!events_registered) {
+		log_line(SCS_LOG_TYPE_error, "Unable to register telemetry event callbacks");
+		return SCS_RESULT_generic_error;
+	}
+
+	//without speed the inputs just use the lowest speed band
+	if (version_params->register_for_channel(truckSpeedChannel, SCS_U32_NIL, SCS_VALUE_TYPE_float, SCS_TELEMETRY_CHANNEL_FLAG_no_value, telemetry_speed_callback, NULL) != SCS_RESULT_ok) {
+		log_line(SCS_LOG_TYPE_warning, "Unable to register for truck speed telemetry");
+	}
+
+	telemetrySpeed.store(0.0f, std::memory_order_relaxed);
+	telemetryPaused.store(true, std::memory_order_relaxed);
+	telemetryActive.store(true, std::memory_order_relaxed);
+	log_line(SCS_LOG_TYPE_message, "telemetry initialised");
+	return SCS_RESULT_ok;
+}
+
+
+// Telemetry API deinitialization function.
+SCSAPI_VOID scs_telemetry_shutdown(void)
+{
+	// The registrations will be removed automatically.
+	telemetryActive.store(false, std::memory_order_relaxed);
+	telemetrySpeed.store(0.0f, std::memory_order_relaxed);
+	telemetryPaused.store(true, std::memory_order_relaxed);
+}
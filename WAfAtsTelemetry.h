@@ -0,0 +1,13 @@
+/*
+* Telemetry half of the plugin, feeds truck state to the input processing
+*/
+#pragma once
+
+#include <atomic>
+
+//latest absolute truck speed in m/s, written by the telemetry callback and read at frame time
+extern std::atomic<float> telemetrySpeed;
+//game is paused (menu, map, loading screen)
+extern std::atomic<bool> telemetryPaused;
+//telemetry api is initialised, without it telemetryPaused means nothing
+extern std::atomic<bool> telemetryActive;
@@ -0,0 +1,133 @@
+/*
+* Optional chrome trace-event recording of the plugin's timeline
+*/
+
+#ifdef WAFATS_TRACE
+
+#include "WAfAtsTrace.h"
+
+#include <atomic>
+#include <cstdio>
+
+#include "ScsSdk/include/scssdk.h"
+
+void log_line(const scs_log_type_t type, const char* const text, ...);
+
+bool traceEnabled = false;
+
+//buffers are rings, once full the oldest spans are overwritten
+const int traceMaxThreads = 4;
+const int traceEventsPerThread = 1 << 16;
+
+struct trace_event_t
+{
+	const char* name;
+	long long begin;
+	long long end;
+};
+
+//only the owning thread writes, count is published with release so the writer never waits on a reader
+struct trace_buffer_t
+{
+	std::atomic<unsigned int> count{ 0 };
+	trace_event_t events[traceEventsPerThread];
+};
+
+trace_buffer_t* traceBuffers = NULL;
+std::atomic<int> traceBuffersClaimed{ 0 };
+//slots stay claimed across reinit so a thread keeps writing to the same buffer
+thread_local int traceThreadSlot = -1;
+int traceTriggerUs = 0;
+bool traceTriggered = false;
+long long traceFrameStart = -1;
+
+void traceInit(bool enabled, int triggerUs)
+{
+	traceEnabled = false;
+	if (!enabled) {
+		return;
+	}
+	if (traceBuffers == NULL) {
+		traceBuffers = new trace_buffer_t[traceMaxThreads];
+	}
+	for (int i{ 0 }; i < traceMaxThreads; ++i) {
+		traceBuffers[i].count.store(0, std::memory_order_relaxed);
+	}
+	traceTriggerUs = triggerUs;
+	traceTriggered = false;
+	traceFrameStart = -1;
+	traceEnabled = true;
+	log_line(SCS_LOG_TYPE_message, "tracing enabled");
+}
+
+void traceRecord(const char* name, long long begin, long long end)
+{
+	if (traceThreadSlot < 0) {
+		traceThreadSlot = traceBuffersClaimed.fetch_add(1, std::memory_order_relaxed);
+	}
+	//more threads than buffers, drop the span
+	if (traceThreadSlot >= traceMaxThreads) {
+		return;
+	}
+	trace_buffer_t& buffer = traceBuffers[traceThreadSlot];
+	unsigned int count = buffer.count.load(std::memory_order_relaxed);
+	buffer.events[count % traceEventsPerThread] = { name, begin, end };
+	buffer.count.store(count + 1, std::memory_order_release);
+}
+
+void traceFrameBegin()
+{
+	if (traceFrameStart < 0) {
+		traceFrameStart = traceNow();
+	}
+}
+
+void traceFrameEnd()
+{
+	if (traceFrameStart < 0) {
+		return;
+	}
+	long long end = traceNow();
+	traceRecord("frame", traceFrameStart, end);
+	if (traceTriggerUs > 0 && !traceTriggered && end - traceFrameStart >= traceTriggerUs) {
+		traceTriggered = true;
+		log_line(SCS_LOG_TYPE_warning, "frame took %lld us, writing trace", end - traceFrameStart);
+		traceWrite();
+	}
+	traceFrameStart = -1;
+}
+
+void traceWrite()
+{
+	FILE* file = NULL;
+	if (fopen_s(&file, "plugins/WAfAts.trace.json", "w") != 0 || file == NULL) {
+		log_line(SCS_LOG_TYPE_error, "failure writing trace file");
+		return;
+	}
+	fputs("{\"traceEvents\":[\n", file);
+	bool first = true;
+	int threads = traceBuffersClaimed.load(std::memory_order_relaxed);
+	for (int t{ 0 }; t < threads && t < traceMaxThreads; ++t) {
+		unsigned int count = traceBuffers[t].count.load(std::memory_order_acquire);
+		unsigned int oldest = count > traceEventsPerThread ? count - traceEventsPerThread : 0;
+		for (unsigned int i{ oldest }; i < count; ++i) {
+			const trace_event_t& event = traceBuffers[t].events[i % traceEventsPerThread];
+			fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%lld,\"dur\":%lld}", first ? "" : ",\n", event.name, t, event.begin, event.end - event.begin);
+			first = false;
+		}
+	}
+	fputs("\n]}\n", file);
+	fclose(file);
+}
+
+void traceShutdown()
+{
+	if (!traceEnabled) {
+		return;
+	}
+	traceEnabled = false;
+	traceWrite();
+	log_line(SCS_LOG_TYPE_message, "trace written to plugins/WAfAts.trace.json");
+}
+
+#endif
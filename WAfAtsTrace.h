@@ -0,0 +1,58 @@
+/*
+* Optional chrome trace-event recording of the plugin's timeline
+* compiled in with WAFATS_TRACE, switched on at runtime with 'trace = 1' in the cfg
+* open the written plugins/WAfAts.trace.json in chrome://tracing or ui.perfetto.dev
+*/
+#pragma once
+
+#ifdef WAFATS_TRACE
+
+#include <chrono>
+
+extern bool traceEnabled;
+
+inline long long traceNow()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//allocate the per thread buffers, call before any span can be recorded
+void traceInit(bool enabled, int triggerUs);
+//store a finished span in the calling thread's buffer
+void traceRecord(const char* name, long long begin, long long end);
+//a frame lasts from the first callback of the frame until the callback runs out of events
+void traceFrameBegin();
+//dumps the buffers once if the frame took longer than the trigger
+void traceFrameEnd();
+//write all buffers to plugins/WAfAts.trace.json
+void traceWrite();
+void traceShutdown();
+
+//records the lifetime of the enclosing scope, name must be a string literal
+struct trace_span_t
+{
+	const char* name;
+	long long begin;
+
+	explicit trace_span_t(const char* spanName) : name(spanName), begin(traceEnabled ? traceNow() : -1) {}
+	~trace_span_t()
+	{
+		if (begin >= 0) {
+			traceRecord(name, begin, traceNow());
+		}
+	}
+};
+
+#define TRACE_CONCAT2(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT2(a, b)
+#define TRACE_SPAN(name) trace_span_t TRACE_CONCAT(traceSpan, __LINE__)(name)
+#define TRACE_FRAME_BEGIN() if (traceEnabled) { traceFrameBegin(); }
+#define TRACE_FRAME_END() if (traceEnabled) { traceFrameEnd(); }
+
+#else
+
+#define TRACE_SPAN(name)
+#define TRACE_FRAME_BEGIN()
+#define TRACE_FRAME_END()
+
+#endif